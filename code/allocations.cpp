@@ -0,0 +1,68 @@
+#include "allocations.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	// Atomic because other tests allocate from several threads.
+	std::atomic<bool> s_counting{false};
+	std::atomic<std::size_t> s_allocations{0};
+
+	auto count_allocation(std::size_t size) -> void*
+	{
+		if (s_counting)
+		{
+			++s_allocations;
+		}
+
+		if (void* p = std::malloc(size ? size : 1))
+		{
+			return p;
+		}
+		throw std::bad_alloc();
+	}
+}
+
+auto start_counting_allocations() -> void
+{
+	s_allocations = 0;
+	s_counting = true;
+}
+
+auto stop_counting_allocations() -> std::size_t
+{
+	s_counting = false;
+	return s_allocations;
+}
+
+auto operator new(std::size_t size) -> void*
+{
+	return count_allocation(size);
+}
+
+auto operator new[](std::size_t size) -> void*
+{
+	return count_allocation(size);
+}
+
+auto operator delete(void* p) noexcept -> void
+{
+	std::free(p);
+}
+
+auto operator delete[](void* p) noexcept -> void
+{
+	std::free(p);
+}
+
+auto operator delete(void* p, std::size_t) noexcept -> void
+{
+	std::free(p);
+}
+
+auto operator delete[](void* p, std::size_t) noexcept -> void
+{
+	std::free(p);
+}
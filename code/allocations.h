@@ -0,0 +1,10 @@
+#ifndef EOP_LANG_ALLOCATIONS_H
+#define EOP_LANG_ALLOCATIONS_H
+
+#include <cstddef>
+
+// Counts calls to operator new, on every thread, between start and stop.
+auto start_counting_allocations() -> void;
+auto stop_counting_allocations() -> std::size_t;
+
+#endif
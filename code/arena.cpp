@@ -0,0 +1,46 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+Arena::Arena(std::size_t block_size) :
+	m_block_size(block_size)
+{
+}
+
+auto Arena::allocate(std::size_t size, std::size_t alignment) -> void*
+{
+	auto address = reinterpret_cast<std::uintptr_t>(m_next);
+	auto aligned = (address + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+	if (!m_next || aligned + size > reinterpret_cast<std::uintptr_t>(m_end))
+	{
+		const std::size_t block_size = std::max(m_block_size, size + alignment);
+		m_blocks.push_back(std::make_unique<char[]>(block_size));
+		m_bytes_reserved += block_size;
+		m_next = m_blocks.back().get();
+		m_end = m_next + block_size;
+		address = reinterpret_cast<std::uintptr_t>(m_next);
+		aligned = (address + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+	}
+
+	m_next += (aligned - address) + size;
+	return reinterpret_cast<void*>(aligned);
+}
+
+auto Arena::copy(std::string_view text) -> std::string_view
+{
+	if (text.empty())
+	{
+		return {};
+	}
+
+	auto data = static_cast<char*>(allocate(text.size(), 1));
+	std::memcpy(data, text.data(), text.size());
+	return std::string_view(data, text.size());
+}
+
+auto Arena::bytes_reserved() const -> std::size_t
+{
+	return m_bytes_reserved;
+}
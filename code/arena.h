@@ -0,0 +1,37 @@
+#ifndef EOP_LANG_ARENA_H
+#define EOP_LANG_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/*
+ * Bump allocator.  Memory is handed out from large blocks and released all at
+ * once when the arena is destroyed; objects placed in it are never destructed.
+ */
+class Arena
+{
+private:
+	std::vector<std::unique_ptr<char[]>> m_blocks;
+	char* m_next = nullptr;
+	char* m_end = nullptr;
+	std::size_t m_block_size;
+	std::size_t m_bytes_reserved = 0;
+
+public:
+	explicit Arena(std::size_t block_size = 64 * 1024);
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+	Arena(Arena&&) = default;
+	Arena& operator=(Arena&&) = default;
+
+	auto allocate(std::size_t size, std::size_t alignment) -> void*;
+	auto copy(std::string_view text) -> std::string_view;
+
+	// Total size of the blocks obtained from the heap.
+	auto bytes_reserved() const -> std::size_t;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include "ast.h"
+
+#include <algorithm>
+#include <cassert>
+
+auto node_kind_name(Node_kind kind) -> const char*
+{
+	static const char* const s_names[] = {
+		"literal",
+		"name",
+		"template_instance",
+		"basic_type",
+		"prefix",
+		"binary",
+		"member",
+		"call",
+		"subscript",
+		"address",
+		"label",
+		"expression_statement",
+		"assignment",
+		"construction",
+		"return",
+		"conditional",
+		"switch",
+		"case",
+		"while",
+		"do",
+		"break",
+		"goto",
+		"compound",
+		"typedef",
+		"enumeration",
+		"enumerator",
+		"parameter",
+		"unnamed_parameter",
+		"structure",
+		"specialization",
+		"data_member",
+		"constructor",
+		"initializer",
+		"destructor",
+		"assign_operator",
+		"apply_operator",
+		"index_operator",
+		"procedure",
+		"constraint",
+		"template",
+		"error",
+		"deferred_body",
+		"unit",
+	};
+	static_assert(sizeof(s_names) / sizeof(s_names[0]) == static_cast<std::size_t>(Node_kind::unit) + 1);
+
+	return s_names[static_cast<std::size_t>(kind)];
+}
+
+Ast::Ast() :
+	// Exactly one block of nodes per arena block.
+	m_arena(s_block_nodes * sizeof(Node) + alignof(Node))
+{
+}
+
+auto Ast::size() const -> std::uint32_t
+{
+	return m_size;
+}
+
+auto Ast::empty() const -> bool
+{
+	return m_size == 0;
+}
+
+auto Ast::operator[](std::uint32_t index) const -> const Node&
+{
+	assert(index < m_size);
+	return m_blocks[index >> s_block_bits][index & (s_block_nodes - 1)];
+}
+
+auto Ast::add_block() -> void
+{
+	m_blocks.push_back(static_cast<Node*>(m_arena.allocate(s_block_nodes * sizeof(Node), alignof(Node))));
+}
+
+auto Ast::truncate(std::uint32_t size) -> void
+{
+	assert(size <= m_size);
+	m_size = size;
+}
+
+auto Ast::clear() -> void
+{
+	m_size = 0;
+}
+
+auto Ast::children(std::uint32_t index) const -> std::vector<std::uint32_t>
+{
+	std::vector<std::uint32_t> result;
+	const std::uint32_t first = (*this)[index].first;
+	for (std::uint32_t child = index; child > first; child = (*this)[child - 1].first)
+	{
+		result.push_back(child - 1);
+	}
+	std::reverse(result.begin(), result.end());
+	return result;
+}
+
+auto Ast::bytes_reserved() const -> std::size_t
+{
+	return m_arena.bytes_reserved() + m_blocks.capacity() * sizeof(Node*);
+}
+
+auto to_string(const Ast& ast, const Token_buffer& tokens, std::uint32_t index) -> std::string
+{
+	const Node& node = ast[index];
+	std::string result = "(";
+	result += node_kind_name(node.kind);
+	if (node.token < tokens.size())
+	{
+		const Token token = tokens.token(node.token);
+		result += ' ';
+		result.append(token.begin, token.end);
+	}
+
+	for (const std::uint32_t child : ast.children(index))
+	{
+		result += ' ';
+		result += to_string(ast, tokens, child);
+	}
+	result += ')';
+	return result;
+}
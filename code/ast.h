@@ -0,0 +1,135 @@
+#ifndef EOP_LANG_AST_H
+#define EOP_LANG_AST_H
+
+#include "arena.h"
+#include "token_buffer.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class Node_kind : std::uint8_t
+{
+	// Expressions; token is the operator, or the token itself for leaves.
+	literal,
+	name,
+	template_instance,
+	basic_type,
+	prefix,
+	binary,
+	member,
+	call,
+	subscript,
+	address,
+
+	// Statements; token is the keyword, name or first token.
+	label,
+	expression_statement,
+	assignment,
+	construction,
+	return_statement,
+	conditional,
+	switch_statement,
+	case_clause,
+	while_statement,
+	do_statement,
+	break_statement,
+	goto_statement,
+	compound,
+	typedef_declaration,
+
+	// Declarations; token is the declared name or the "operator" keyword.
+	enumeration,
+	enumerator,
+	parameter,
+	unnamed_parameter,
+	structure,
+	specialization,
+	data_member,
+	constructor,
+	initializer,
+	destructor,
+	assign_operator,
+	apply_operator,
+	index_operator,
+	procedure,
+	constraint,
+	template_declaration,
+
+	// A construct a recovering parse skipped, at its first token.
+	error,
+
+	// A body skipped by a lazy or parallel parse, to be parsed separately.
+	deferred_body,
+
+	// The root, following every top-level declaration.
+	unit,
+};
+
+auto node_kind_name(Node_kind kind) -> const char*;
+
+/*
+ * Nodes are stored in postorder: each follows its children, and its subtree
+ * is the range [first, index].  The last child is at index - 1 and each
+ * child's previous sibling is just before the child's own first.
+ */
+struct Node
+{
+	Node_kind kind;
+	std::uint32_t token;
+	std::uint32_t first;
+};
+
+/*
+ * Syntax tree of one parse, referring to the source by token index.  Nodes
+ * live in fixed-size blocks carved from an arena; truncating or clearing
+ * keeps the blocks for reuse and they are all released with the tree.
+ */
+class Ast
+{
+private:
+	static constexpr unsigned s_block_bits = 12;
+	static constexpr std::uint32_t s_block_nodes = 1u << s_block_bits;
+
+	Arena m_arena;
+	std::vector<Node*> m_blocks;
+	std::uint32_t m_size = 0;
+
+	auto add_block() -> void;
+
+public:
+	Ast();
+
+	auto size() const -> std::uint32_t;
+	auto empty() const -> bool;
+	auto operator[](std::uint32_t index) const -> const Node&;
+
+	// Inline, since the parser pushes a node for nearly every token it accepts.
+	auto push_back(Node node) -> void
+	{
+		if (m_size == m_blocks.size() * s_block_nodes)
+		{
+			add_block();
+		}
+
+		assert(node.first <= m_size);
+		m_blocks[m_size >> s_block_bits][m_size & (s_block_nodes - 1)] = node;
+		++m_size;
+	}
+
+	// Drops the nodes from index size onwards, as when backtracking.
+	auto truncate(std::uint32_t size) -> void;
+	auto clear() -> void;
+
+	// Direct children in source order.
+	auto children(std::uint32_t index) const -> std::vector<std::uint32_t>;
+
+	auto bytes_reserved() const -> std::size_t;
+};
+
+// The subtree at index as an s-expression, naming each node's token, for tests and debugging.
+auto to_string(const Ast& ast, const Token_buffer& tokens, std::uint32_t index) -> std::string;
+
+#endif
@@ -0,0 +1,45 @@
+#include "ast.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+TEST_CASE("Tree children in source order", "[ast]")
+{
+	// (binary (name) (call (name) (literal)))
+	Ast ast;
+	ast.push_back(Node{Node_kind::name, 0, 0});
+	ast.push_back(Node{Node_kind::name, 2, 1});
+	ast.push_back(Node{Node_kind::literal, 4, 2});
+	ast.push_back(Node{Node_kind::call, 3, 1});
+	ast.push_back(Node{Node_kind::binary, 1, 0});
+
+	REQUIRE(ast.children(4) == std::vector<std::uint32_t>{0, 3});
+	REQUIRE(ast.children(3) == std::vector<std::uint32_t>{1, 2});
+	REQUIRE(ast.children(0).empty());
+}
+
+TEST_CASE("Tree truncates and reuses its blocks", "[ast]")
+{
+	Ast ast;
+	for (std::uint32_t i = 0; i < 10000; ++i)
+	{
+		ast.push_back(Node{Node_kind::literal, i, i});
+	}
+	REQUIRE(ast.size() == 10000);
+	REQUIRE(ast[9999].token == 9999);
+	REQUIRE(ast[4096].token == 4096);
+
+	const std::size_t reserved = ast.bytes_reserved();
+	ast.truncate(5000);
+	REQUIRE(ast.size() == 5000);
+	ast.clear();
+	REQUIRE(ast.empty());
+
+	for (std::uint32_t i = 0; i < 10000; ++i)
+	{
+		ast.push_back(Node{Node_kind::name, i, i});
+	}
+	REQUIRE(ast[4095].kind == Node_kind::name);
+	REQUIRE(ast.bytes_reserved() == reserved);
+}
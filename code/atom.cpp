@@ -0,0 +1,124 @@
+#include "atom.h"
+
+#include <cassert>
+
+namespace
+{
+	auto hash_name(std::string_view name) -> std::uint64_t
+	{
+		// FNV-1a
+		std::uint64_t hash = 14695981039346656037ull;
+		for (char c : name)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	Atom_table s_pool;
+}
+
+auto Atom_table::shard_of(std::uint64_t hash) -> Shard&
+{
+	return m_shards[hash >> (64 - s_shard_bits)];
+}
+
+auto Atom_table::find_slot(Shard& shard, std::string_view name, std::uint64_t hash) -> Slot&
+{
+	const std::size_t mask = shard.slots.size() - 1;
+	for (std::size_t i = hash & mask; ; i = (i + 1) & mask)
+	{
+		Slot& slot = shard.slots[i];
+		if (slot.atom == null_atom || (slot.hash == hash && shard.names[slot.atom >> s_shard_bits] == name))
+		{
+			return slot;
+		}
+	}
+}
+
+auto Atom_table::grow(Shard& shard) -> void
+{
+	std::vector<Slot> slots(shard.slots.size() * 2, Slot{0, null_atom});
+	const std::size_t mask = slots.size() - 1;
+	for (const Slot& slot : shard.slots)
+	{
+		if (slot.atom == null_atom)
+		{
+			continue;
+		}
+
+		std::size_t i = slot.hash & mask;
+		while (slots[i].atom != null_atom)
+		{
+			i = (i + 1) & mask;
+		}
+		slots[i] = slot;
+	}
+	shard.slots.swap(slots);
+}
+
+auto Atom_table::intern(std::string_view name) -> Atom
+{
+	const std::uint64_t hash = hash_name(name);
+	Shard& shard = shard_of(hash);
+
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	Slot* slot = &find_slot(shard, name, hash);
+	if (slot->atom != null_atom)
+	{
+		return slot->atom;
+	}
+
+	// Keep the load factor at or below one half.
+	if (2 * shard.names.size() >= shard.slots.size())
+	{
+		grow(shard);
+		slot = &find_slot(shard, name, hash);
+	}
+
+	const auto index = static_cast<Atom>(shard.names.size());
+	assert(index < (Atom(1) << (32 - s_shard_bits)));
+	shard.names.push_back(shard.strings.copy(name));
+	const auto atom = static_cast<Atom>(index << s_shard_bits | static_cast<Atom>(&shard - m_shards));
+	*slot = Slot{hash, atom};
+	return atom;
+}
+
+auto Atom_table::find(std::string_view name) -> Atom
+{
+	const std::uint64_t hash = hash_name(name);
+	Shard& shard = shard_of(hash);
+
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	return find_slot(shard, name, hash).atom;
+}
+
+auto Atom_table::name(Atom atom) -> std::string_view
+{
+	Shard& shard = m_shards[atom & (s_shard_count - 1)];
+
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	assert((atom >> s_shard_bits) < shard.names.size());
+	return shard.names[atom >> s_shard_bits];
+}
+
+auto atom_pool() -> Atom_table&
+{
+	return s_pool;
+}
+
+auto atom_intern(std::string_view name) -> Atom
+{
+	return atom_pool().intern(name);
+}
+
+auto atom_find(std::string_view name) -> Atom
+{
+	return atom_pool().find(name);
+}
+
+auto atom_name(Atom atom) -> std::string_view
+{
+	return atom_pool().name(atom);
+}
@@ -0,0 +1,87 @@
+#ifndef EOP_LANG_ATOM_H
+#define EOP_LANG_ATOM_H
+
+#include "arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+/*
+ * Interned names.  Every distinct spelling is stored once in an atom table
+ * and identified by a 32-bit atom, so names compare and hash as integers.
+ * Atoms are handed out densely within each of a small number of shards.
+ */
+using Atom = std::uint32_t;
+
+inline constexpr Atom null_atom = 0;
+
+/*
+ * A pool of interned names, safe to use from several threads.  Names are
+ * kept until the table is destroyed, so a long-running host that lexes
+ * ever new text, as an editor does, gives each document or session a table
+ * of its own and drops it with them.  Atoms from different tables are not
+ * comparable.
+ */
+class Atom_table
+{
+private:
+	struct Slot
+	{
+		std::uint64_t hash;
+		Atom atom;
+	};
+
+	/*
+	 * The pool is split into shards, chosen by hash, so that threads
+	 * interning different names rarely contend for a lock.  The low bits of
+	 * an atom hold its shard and the high bits its index within the shard.
+	 */
+	static constexpr unsigned s_shard_bits = 4;
+	static constexpr std::size_t s_shard_count = std::size_t(1) << s_shard_bits;
+
+	struct Shard
+	{
+		std::mutex mutex;
+		Arena strings;
+		// Indexed by atom >> s_shard_bits; index 0 is never handed out, so no
+		// atom equals null_atom.
+		std::vector<std::string_view> names{std::string_view()};
+		// Open addressing with linear probing; the size is a power of two.
+		std::vector<Slot> slots{std::vector<Slot>(256, Slot{0, null_atom})};
+	};
+
+	Shard m_shards[s_shard_count];
+
+	auto shard_of(std::uint64_t hash) -> Shard&;
+	static auto find_slot(Shard& shard, std::string_view name, std::uint64_t hash) -> Slot&;
+	static auto grow(Shard& shard) -> void;
+
+public:
+	Atom_table() = default;
+	Atom_table(const Atom_table&) = delete;
+	Atom_table& operator=(const Atom_table&) = delete;
+
+	auto intern(std::string_view name) -> Atom;
+
+	// The atom for name if it has been interned, otherwise null_atom.
+	auto find(std::string_view name) -> Atom;
+
+	// The spelling of an atom; valid for the lifetime of the table.
+	auto name(Atom atom) -> std::string_view;
+};
+
+// The process-wide table, used wherever no other is given; it is never freed.
+auto atom_pool() -> Atom_table&;
+
+auto atom_intern(std::string_view name) -> Atom;
+
+// The atom for name if it has been interned, otherwise null_atom.
+auto atom_find(std::string_view name) -> Atom;
+
+// The spelling of an atom; valid for the lifetime of the process.
+auto atom_name(Atom atom) -> std::string_view;
+
+#endif
@@ -0,0 +1,52 @@
+#include "atom.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+TEST_CASE("Intern returns one atom per spelling", "[atom]")
+{
+	const Atom x = atom_intern("atom_test_x");
+	REQUIRE(x != null_atom);
+	REQUIRE(atom_intern(std::string("atom_test_x")) == x);
+	REQUIRE(atom_intern("atom_test_y") != x);
+	REQUIRE(atom_name(x) == "atom_test_x");
+}
+
+TEST_CASE("Find does not intern", "[atom]")
+{
+	REQUIRE(atom_find("atom_test_never_interned") == null_atom);
+	const Atom z = atom_intern("atom_test_z");
+	REQUIRE(atom_find("atom_test_z") == z);
+}
+
+TEST_CASE("Intern many names", "[atom]")
+{
+	// Enough names to grow the table several times.
+	for (int i = 0; i < 20000; ++i)
+	{
+		const std::string name = "atom_test_many_" + std::to_string(i);
+		const Atom atom = atom_intern(name);
+		REQUIRE(atom_name(atom) == name);
+	}
+
+	for (int i = 0; i < 20000; i += 997)
+	{
+		const std::string name = "atom_test_many_" + std::to_string(i);
+		REQUIRE(atom_name(atom_find(name)) == name);
+	}
+}
+
+TEST_CASE("Atom tables are separate", "[atom]")
+{
+	Atom_table table;
+	const Atom x = table.intern("atom_test_scoped_x");
+	REQUIRE(x != null_atom);
+	REQUIRE(table.intern("atom_test_scoped_x") == x);
+	REQUIRE(table.find("atom_test_scoped_x") == x);
+	REQUIRE(table.name(x) == "atom_test_scoped_x");
+
+	// Names in a table of their own never reach the process-wide pool.
+	REQUIRE(atom_find("atom_test_scoped_x") == null_atom);
+	REQUIRE(table.find("atom_test_x_never_in_table") == null_atom);
+}
@@ -0,0 +1,67 @@
+#include "corpus.h"
+
+namespace
+{
+	auto append_declaration(std::string& output, std::size_t n) -> void
+	{
+		const std::string id = std::to_string(n);
+		switch (n % 5)
+		{
+		case 0: {
+			output += "struct pair_" + id + "\n"
+				"{\n"
+				"\tint first;\n"
+				"\tint second;\n"
+				"\tpair_" + id + "(int a, int b) : first(a), second(b) { }\n"
+				"\t~pair_" + id + "() { }\n"
+				"};\n\n";
+		} break;
+
+		case 1: {
+			output += "// Squares a value of a regular type.\n"
+				"template <typename T>\n"
+				"requires(Regular(T))\n"
+				"T square_" + id + "(const T& x)\n"
+				"{\n"
+				"\treturn x * x;\n"
+				"}\n\n";
+		} break;
+
+		case 2: {
+			output += "int sum_" + id + "(int a, int b)\n"
+				"{\n"
+				"\tint c;\n"
+				"\tc = a + b * 2 - (a % 3);\n"
+				"\tif (a < b && b != 0) { c = c + 1; } else { c = c - 1; }\n"
+				"\twhile (c > 0) c = c - 1;\n"
+				"\tdo { c = c + 1; } while (c <= 10);\n"
+				"\treturn c;\n"
+				"}\n\n";
+		} break;
+
+		case 3: {
+			output += "enum color_" + id + " { red, green, blue };\n\n";
+		} break;
+
+		case 4: {
+			output += "bool equal_" + id + "(const pair_" + std::to_string(n - 4) + "& x, const pair_" + std::to_string(n - 4) + "& y)\n"
+				"{\n"
+				"\ttypedef pair_" + std::to_string(n - 4) + " P;\n"
+				"\tP<int> z;\n"
+				"\treturn x.first == y.first || !(x.second < 2.5) && z.first >= 0;\n"
+				"}\n\n";
+		} break;
+		}
+	}
+}
+
+auto generate_corpus(std::size_t bytes) -> std::string
+{
+	std::string output;
+	output.reserve(bytes + 512);
+	for (std::size_t n = 0; output.size() < bytes; ++n)
+	{
+		append_declaration(output, n);
+	}
+	return output;
+}
@@ -0,0 +1,10 @@
+#ifndef EOP_LANG_CORPUS_H
+#define EOP_LANG_CORPUS_H
+
+#include <cstddef>
+#include <string>
+
+// Valid EOP source of at least the given size, built from a rotating set of declarations.
+auto generate_corpus(std::size_t bytes) -> std::string;
+
+#endif
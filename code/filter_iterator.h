@@ -1,6 +1,7 @@
 #ifndef EOP_LANG_FILTER_ITERATOR_H
 #define EOP_LANG_FILTER_ITERATOR_H
 
+#include <algorithm>
 #include <iterator>
 
 template <typename I, typename P>
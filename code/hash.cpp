@@ -0,0 +1,111 @@
+#include "hash.h"
+
+#include <cstring>
+
+namespace
+{
+	constexpr std::uint64_t s_prime1 = 0x9e3779b185ebca87ull;
+	constexpr std::uint64_t s_prime2 = 0xc2b2ae3d27d4eb4full;
+	constexpr std::uint64_t s_prime3 = 0x165667b19e3779f9ull;
+	constexpr std::uint64_t s_prime4 = 0x85ebca77c2b2ae63ull;
+	constexpr std::uint64_t s_prime5 = 0x27d4eb2f165667c5ull;
+
+	auto rotate_left(std::uint64_t x, unsigned r) -> std::uint64_t
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+
+	// Little-endian loads, so that the hash is the same on every platform.
+	auto load64(const char* p) -> std::uint64_t
+	{
+		unsigned char b[8];
+		std::memcpy(b, p, 8);
+		std::uint64_t x = 0;
+		for (int i = 7; i >= 0; --i)
+		{
+			x = x << 8 | b[i];
+		}
+		return x;
+	}
+
+	auto load32(const char* p) -> std::uint64_t
+	{
+		unsigned char b[4];
+		std::memcpy(b, p, 4);
+		return std::uint64_t(b[0]) | std::uint64_t(b[1]) << 8 | std::uint64_t(b[2]) << 16 | std::uint64_t(b[3]) << 24;
+	}
+
+	auto round(std::uint64_t acc, std::uint64_t input) -> std::uint64_t
+	{
+		acc += input * s_prime2;
+		acc = rotate_left(acc, 31);
+		return acc * s_prime1;
+	}
+
+	auto merge_round(std::uint64_t acc, std::uint64_t value) -> std::uint64_t
+	{
+		acc ^= round(0, value);
+		return acc * s_prime1 + s_prime4;
+	}
+}
+
+auto xxhash64(const char* data, std::size_t size, std::uint64_t seed) -> std::uint64_t
+{
+	const char* p = data;
+	const char* end = data + size;
+	std::uint64_t h;
+
+	if (size >= 32)
+	{
+		// Four independent lanes over 32-byte stripes.
+		std::uint64_t v1 = seed + s_prime1 + s_prime2;
+		std::uint64_t v2 = seed + s_prime2;
+		std::uint64_t v3 = seed;
+		std::uint64_t v4 = seed - s_prime1;
+		for (const char* limit = end - 32; p <= limit; p += 32)
+		{
+			v1 = round(v1, load64(p));
+			v2 = round(v2, load64(p + 8));
+			v3 = round(v3, load64(p + 16));
+			v4 = round(v4, load64(p + 24));
+		}
+
+		h = rotate_left(v1, 1) + rotate_left(v2, 7) + rotate_left(v3, 12) + rotate_left(v4, 18);
+		h = merge_round(h, v1);
+		h = merge_round(h, v2);
+		h = merge_round(h, v3);
+		h = merge_round(h, v4);
+	}
+	else
+	{
+		h = seed + s_prime5;
+	}
+
+	h += static_cast<std::uint64_t>(size);
+
+	for (; end - p >= 8; p += 8)
+	{
+		h ^= round(0, load64(p));
+		h = rotate_left(h, 27) * s_prime1 + s_prime4;
+	}
+
+	if (end - p >= 4)
+	{
+		h ^= load32(p) * s_prime1;
+		h = rotate_left(h, 23) * s_prime2 + s_prime3;
+		p += 4;
+	}
+
+	for (; p != end; ++p)
+	{
+		h ^= static_cast<unsigned char>(*p) * s_prime5;
+		h = rotate_left(h, 11) * s_prime1;
+	}
+
+	h ^= h >> 33;
+	h *= s_prime2;
+	h ^= h >> 29;
+	h *= s_prime3;
+	h ^= h >> 32;
+	return h;
+}
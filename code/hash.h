@@ -0,0 +1,10 @@
+#ifndef EOP_LANG_HASH_H
+#define EOP_LANG_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// XXH64 of the bytes, the same value as the reference implementation gives.
+auto xxhash64(const char* data, std::size_t size, std::uint64_t seed = 0) -> std::uint64_t;
+
+#endif
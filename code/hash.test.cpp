@@ -0,0 +1,37 @@
+#include "hash.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+TEST_CASE("Hash matches the reference XXH64", "[hash]")
+{
+	const auto hash = [](const std::string& text, std::uint64_t seed) {
+		return xxhash64(text.data(), text.size(), seed);
+	};
+
+	REQUIRE(hash("", 0) == 0xef46db3751d8e999ull);
+	REQUIRE(hash("a", 0) == 0xd24ec4f1a98c6e5bull);
+	REQUIRE(hash("abc", 0) == 0x44bc2cf5ad770999ull);
+	REQUIRE(hash("Nobody inspects the spammish repetition", 0) == 0xfbcea83c8a378bf1ull);
+}
+
+TEST_CASE("Hash depends on every byte and the seed", "[hash]")
+{
+	const std::string text(100, 'x');
+	const std::uint64_t reference = xxhash64(text.data(), text.size());
+	REQUIRE(xxhash64(text.data(), text.size(), 1) != reference);
+
+	// Every length up to a few stripes, with a change at every position.
+	for (std::size_t size = 1; size <= text.size(); ++size)
+	{
+		const std::uint64_t whole = xxhash64(text.data(), size);
+		REQUIRE(xxhash64(text.data(), size - 1) != whole);
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			std::string changed = text.substr(0, size);
+			changed[i] = 'y';
+			REQUIRE(xxhash64(changed.data(), size) != whole);
+		}
+	}
+}
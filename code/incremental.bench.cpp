@@ -0,0 +1,65 @@
+#include "corpus.h"
+#include "incremental.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+TEST_CASE("Incremental edit latency", "[benchmark]")
+{
+	// Grow the corpus to 50k lines.
+	std::string text = generate_corpus(1 << 20);
+	while (std::count(text.begin(), text.end(), '\n') < 50000)
+	{
+		text = generate_corpus(text.size() * 2);
+	}
+	const std::size_t lines = static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n'));
+
+	Incremental_parser parser(text);
+	REQUIRE(parser.passed());
+
+	const std::size_t body = text.find("c = c + 1;", text.size() / 2);
+	const std::size_t name = text.find("\nstruct pair_", text.size() / 2) + 13;
+
+	// Worst of many keystrokes, typing a character into a body and deleting it.
+	double worst = 0;
+	for (int i = 0; i < 200; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		if (i % 2 == 0)
+		{
+			parser.edit(body, 0, "c");
+		}
+		else
+		{
+			parser.edit(body, 1, "");
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		worst = std::max(worst, elapsed.count());
+	}
+	REQUIRE(parser.passed());
+	std::printf("%zu lines, %zu declarations: worst keystroke in a body %.3f ms\n", lines, parser.size(), worst * 1e3);
+
+	BENCHMARK("Keystroke in a body of 50k lines")
+	{
+		parser.edit(body, 0, "c");
+		parser.edit(body, 1, "");
+		return parser.passed();
+	};
+
+	BENCHMARK("Keystroke in a structure name of 50k lines")
+	{
+		parser.edit(name, 0, "x");
+		parser.edit(name, 1, "");
+		return parser.passed();
+	};
+
+	BENCHMARK("Whole parse of 50k lines")
+	{
+		return parse(text.data(), text.data() + text.size());
+	};
+}
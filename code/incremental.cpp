@@ -0,0 +1,401 @@
+#include "incremental.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace
+{
+	auto add_name(std::array<std::uint64_t, 4>& filter, Atom name) -> void
+	{
+		const std::uint32_t bit = static_cast<std::uint32_t>(name * 0x9e3779b9u) >> 24;
+		filter[bit >> 6] |= std::uint64_t(1) << (bit & 63);
+	}
+
+	auto intersects(const std::array<std::uint64_t, 4>& x, const std::array<std::uint64_t, 4>& y) -> bool
+	{
+		return ((x[0] & y[0]) | (x[1] & y[1]) | (x[2] & y[2]) | (x[3] & y[3])) != 0;
+	}
+
+	auto token_end(const Token_buffer& tokens, std::uint32_t index) -> std::size_t
+	{
+		return static_cast<std::size_t>(tokens.token(index).end - tokens.source());
+	}
+
+	auto last_kind(const Token_buffer& tokens) -> Token_kind
+	{
+		return tokens.kind(tokens.size() - 1);
+	}
+
+	auto same_globals(const std::vector<Symbol>& x, const std::vector<Symbol>& y) -> bool
+	{
+		return std::equal(x.begin(), x.end(), y.begin(), y.end(), [](const Symbol& a, const Symbol& b) {
+			return a.name == b.name && a.kind == b.kind;
+		});
+	}
+
+	/*
+	 * Splits tokens into top-level declarations as find_declarations does,
+	 * except that an unbalanced "}" ends a declaration of its own, so every
+	 * token belongs to one.  Returns whether the last declaration is closed,
+	 * so that whatever follows the tokens begins a new one.
+	 */
+	auto split_declarations(const Token_buffer& tokens, std::vector<std::uint32_t>& ends) -> bool
+	{
+		ends.clear();
+		const std::uint32_t size = tokens.size();
+		std::uint32_t depth = 0;
+		bool closed = true;
+		for (std::uint32_t i = 0; i < size; ++i)
+		{
+			closed = false;
+			switch (tokens.kind(i))
+			{
+			case Token_kind::open_brace: {
+				++depth;
+			} break;
+
+			case Token_kind::close_brace: {
+				if (depth == 0)
+				{
+					closed = true;
+				}
+				else if (--depth == 0)
+				{
+					closed = i + 1 == size || tokens.kind(i + 1) != Token_kind::semicolon;
+				}
+			} break;
+
+			case Token_kind::semicolon: {
+				closed = depth == 0;
+			} break;
+
+			default: {
+			} break;
+			}
+
+			if (closed)
+			{
+				ends.push_back(i + 1);
+			}
+		}
+
+		if (!closed)
+		{
+			ends.push_back(size);
+		}
+		return closed;
+	}
+}
+
+Incremental_parser::Incremental_parser(std::string_view text, Atom_table* atoms)
+{
+	m_context.atoms = atoms;
+	auto empty = std::make_unique<Incremental_declaration>();
+	empty->begin = 0;
+	empty->parsed = true;
+	empty->cut_off = false;
+	m_declarations.push_back(std::move(empty));
+	m_filters.push_back(Name_filter{});
+	edit(0, 0, text);
+}
+
+auto Incremental_parser::parse_declaration(std::size_t index) -> void
+{
+	Incremental_declaration& declaration = *m_declarations[index];
+	Symbol_table& symbols = m_context.symbols;
+	const std::size_t depth = symbols.depth();
+	const std::size_t before = symbols.bindings();
+	const char* text = declaration.text.data();
+	declaration.parsed = parse_more(m_context, text, text + declaration.text.size());
+	declaration.cut_off = !declaration.parsed && m_context.position == m_context.tokens.size();
+
+	// A declaration that failed inside a block leaves its scopes open.
+	while (symbols.depth() > depth)
+	{
+		symbols.pop_scope();
+	}
+
+	declaration.globals.clear();
+	for (std::size_t i = before; i < symbols.bindings(); ++i)
+	{
+		declaration.globals.push_back(symbols.binding(i));
+	}
+
+	declaration.nodes.clear();
+	if (declaration.parsed)
+	{
+		for (std::uint32_t i = 0; i + 1 < m_context.ast.size(); ++i)
+		{
+			declaration.nodes.push_back(m_context.ast[i]);
+		}
+	}
+
+	declaration.tokens = std::move(m_context.tokens);
+	declaration.names.clear();
+	for (std::uint32_t i = 0; i < declaration.tokens.size(); ++i)
+	{
+		if (declaration.tokens.atom(i) != null_atom)
+		{
+			declaration.names.push_back(declaration.tokens.atom(i));
+		}
+	}
+	std::sort(declaration.names.begin(), declaration.names.end());
+	declaration.names.erase(std::unique(declaration.names.begin(), declaration.names.end()), declaration.names.end());
+
+	Name_filter& filter = m_filters[index];
+	filter = Name_filter{};
+	for (const Atom name : declaration.names)
+	{
+		add_name(filter, name);
+	}
+	++m_reparsed;
+}
+
+auto Incremental_parser::edit(std::uint64_t offset, std::uint64_t removed, std::string_view inserted) -> void
+{
+	assert(offset + removed <= m_size);
+	m_reparsed = 0;
+
+	// From the first declaration ending at or after offset through the last beginning before the removed bytes end.
+	std::size_t first = static_cast<std::size_t>(std::lower_bound(m_declarations.begin(), m_declarations.end() - 1, offset,
+		[](const std::unique_ptr<Incremental_declaration>& declaration, std::uint64_t offset) {
+			return declaration->begin + declaration->text.size() < offset;
+		}) - m_declarations.begin());
+	std::size_t last = first;
+	while (last + 1 < m_declarations.size() && m_declarations[last + 1]->begin < offset + removed)
+	{
+		++last;
+	}
+
+	std::string text;
+	for (std::size_t i = first; i <= last; ++i)
+	{
+		text += m_declarations[i]->text;
+	}
+	text.replace(static_cast<std::size_t>(offset - m_declarations[first]->begin), static_cast<std::size_t>(removed), inserted);
+
+	/*
+	 * Widen the window until the declarations on either side of it begin and
+	 * end where a whole parse would split them: its tokens must end with a
+	 * closed declaration at the end of its text, without a ";" after a "}"
+	 * on either side.  It widens forward by its own size each time, so text
+	 * that leaves a brace open is lexed a bounded number of times over.
+	 */
+	Token_buffer tokens;
+	std::vector<std::uint32_t> ends;
+	while (true)
+	{
+		// Only the kinds place the boundaries; each declaration interns its names when it is parsed.
+		tokens = Token_buffer(text.data(), text.data() + text.size());
+		const bool closed = split_declarations(tokens, ends);
+		const bool at_end = last + 1 == m_declarations.size();
+
+		bool backward = false;
+		if (first != 0)
+		{
+			const Token_buffer& previous = m_declarations[first - 1]->tokens;
+			backward = tokens.size() == 0 ? at_end :
+				tokens.kind(0) == Token_kind::semicolon && previous.size() != 0 && last_kind(previous) == Token_kind::close_brace;
+		}
+
+		bool forward = false;
+		if (!at_end)
+		{
+			const Token_buffer& next = m_declarations[last + 1]->tokens;
+			forward = tokens.size() == 0 || !closed || token_end(tokens, tokens.size() - 1) != text.size() ||
+				(last_kind(tokens) == Token_kind::close_brace && next.size() != 0 && next.kind(0) == Token_kind::semicolon);
+		}
+
+		if (!backward && !forward)
+		{
+			break;
+		}
+
+		if (backward)
+		{
+			--first;
+			text.insert(0, m_declarations[first]->text);
+		}
+
+		if (forward)
+		{
+			const std::size_t more = std::min(last - first + 1, m_declarations.size() - 1 - last);
+			for (std::size_t i = 1; i <= more; ++i)
+			{
+				text += m_declarations[last + i]->text;
+			}
+			last += more;
+		}
+	}
+
+	const std::uint64_t begin = m_declarations[first]->begin;
+	std::vector<std::unique_ptr<Incremental_declaration>> created;
+	std::size_t byte = 0;
+	for (std::size_t i = 0; i < ends.size(); ++i)
+	{
+		const std::size_t end = i + 1 == ends.size() ? text.size() : token_end(tokens, ends[i] - 1);
+		auto declaration = std::make_unique<Incremental_declaration>();
+		declaration->begin = begin + byte;
+		declaration->text = text.substr(byte, end - byte);
+		created.push_back(std::move(declaration));
+		byte = end;
+	}
+	if (created.empty())
+	{
+		auto declaration = std::make_unique<Incremental_declaration>();
+		declaration->begin = begin;
+		declaration->text = std::move(text);
+		created.push_back(std::move(declaration));
+	}
+
+	std::vector<Symbol> old_globals;
+	for (std::size_t i = first; i <= last; ++i)
+	{
+		const std::vector<Symbol>& globals = m_declarations[i]->globals;
+		old_globals.insert(old_globals.end(), globals.begin(), globals.end());
+	}
+
+	const std::size_t count = created.size();
+	m_declarations.erase(m_declarations.begin() + static_cast<std::ptrdiff_t>(first), m_declarations.begin() + static_cast<std::ptrdiff_t>(last + 1));
+	m_declarations.insert(m_declarations.begin() + static_cast<std::ptrdiff_t>(first),
+		std::make_move_iterator(created.begin()), std::make_move_iterator(created.end()));
+	m_filters.erase(m_filters.begin() + static_cast<std::ptrdiff_t>(first), m_filters.begin() + static_cast<std::ptrdiff_t>(last + 1));
+	m_filters.insert(m_filters.begin() + static_cast<std::ptrdiff_t>(first), count, Name_filter{});
+	m_size = m_size - removed + inserted.size();
+	for (std::size_t i = first + count; i < m_declarations.size(); ++i)
+	{
+		m_declarations[i]->begin = m_declarations[i]->begin - removed + inserted.size();
+	}
+
+	// The globals of the declarations before the window are all the window
+	// sees; those of the window and after are scoped to be dropped again.
+	Symbol_table& symbols = m_context.symbols;
+	if (first < m_prefix)
+	{
+		symbols.clear();
+		m_prefix = 0;
+	}
+	for (; m_prefix < first; ++m_prefix)
+	{
+		for (const Symbol& symbol : m_declarations[m_prefix]->globals)
+		{
+			symbols.push(symbol.name, symbol.kind);
+		}
+	}
+	symbols.push_scope();
+
+	std::vector<Symbol> new_globals;
+	for (std::size_t i = first; i < first + count; ++i)
+	{
+		parse_declaration(i);
+		const std::vector<Symbol>& globals = m_declarations[i]->globals;
+		new_globals.insert(new_globals.end(), globals.begin(), globals.end());
+	}
+
+	if (same_globals(old_globals, new_globals))
+	{
+		symbols.pop_scope();
+		return;
+	}
+
+	/*
+	 * A later declaration parses differently only if it names a global whose
+	 * binding changed, and then may change further globals in turn.  The
+	 * rest keep their trees, and their globals are only declared when one
+	 * after them has to be parsed again.
+	 */
+	std::vector<Atom> changed;
+	Name_filter changed_names{};
+	auto change = [&](const std::vector<Symbol>& globals) {
+		for (const Symbol& symbol : globals)
+		{
+			changed.push_back(symbol.name);
+			add_name(changed_names, symbol.name);
+		}
+	};
+	change(old_globals);
+	change(new_globals);
+
+	std::size_t declared = first + count;
+	for (std::size_t i = first + count; i < m_declarations.size(); ++i)
+	{
+		if (!intersects(m_filters[i], changed_names))
+		{
+			continue;
+		}
+
+		Incremental_declaration& declaration = *m_declarations[i];
+		const bool affected = std::any_of(changed.begin(), changed.end(), [&](Atom name) {
+			return std::binary_search(declaration.names.begin(), declaration.names.end(), name);
+		});
+		if (!affected)
+		{
+			continue;
+		}
+
+		for (; declared < i; ++declared)
+		{
+			for (const Symbol& symbol : m_declarations[declared]->globals)
+			{
+				symbols.push(symbol.name, symbol.kind);
+			}
+		}
+
+		const std::vector<Symbol> globals = declaration.globals;
+		parse_declaration(i);
+		declared = i + 1;
+		if (!same_globals(globals, declaration.globals))
+		{
+			change(globals);
+			change(declaration.globals);
+		}
+	}
+	symbols.pop_scope();
+}
+
+auto Incremental_parser::passed() const -> bool
+{
+	for (std::size_t i = 0; i < m_declarations.size(); ++i)
+	{
+		const Incremental_declaration& declaration = *m_declarations[i];
+
+		// As parse accepts a declaration cut off by the end of the input.
+		if (!declaration.parsed && !(declaration.cut_off && i + 1 == m_declarations.size()))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+auto Incremental_parser::size() const -> std::size_t
+{
+	return m_declarations.size();
+}
+
+auto Incremental_parser::declaration(std::size_t index) const -> const Incremental_declaration&
+{
+	return *m_declarations[index];
+}
+
+auto Incremental_parser::text() const -> std::string
+{
+	std::string text;
+	text.reserve(static_cast<std::size_t>(m_size));
+	for (const std::unique_ptr<Incremental_declaration>& declaration : m_declarations)
+	{
+		text += declaration->text;
+	}
+	return text;
+}
+
+auto Incremental_parser::bytes() const -> std::uint64_t
+{
+	return m_size;
+}
+
+auto Incremental_parser::reparsed() const -> std::size_t
+{
+	return m_reparsed;
+}
@@ -0,0 +1,86 @@
+#ifndef EOP_LANG_INCREMENTAL_H
+#define EOP_LANG_INCREMENTAL_H
+
+#include "parser.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A top-level declaration, lexed and parsed on its own.
+struct Incremental_declaration
+{
+	// From the end of the previous declaration's last token through its own,
+	// or to the end of the input for the last declaration.
+	std::uint64_t begin;
+	std::string text;
+
+	Token_buffer tokens;
+
+	// Its tree in postorder without a unit node, by index into tokens.
+	std::vector<Node> nodes;
+	bool parsed;
+
+	// It stopped at its last token, which the last declaration may.
+	bool cut_off;
+
+	// The global names it declares, in order.
+	std::vector<Symbol> globals;
+
+	// The names among its tokens, sorted.
+	std::vector<Atom> names;
+};
+
+/*
+ * Keeps an input parsed across edits.  Each top-level declaration has its
+ * own text, tokens and tree, so an edit re-lexes and reparses only the
+ * declarations it touches, widening the window until the boundaries of the
+ * declarations it leaves alone are those a whole parse would find.  A later
+ * declaration is parsed again only if it names a global whose binding the
+ * reparsed ones changed, so the result is always that of parsing the whole
+ * input with parse.
+ */
+class Incremental_parser
+{
+private:
+	// A bit for each name of each declaration, kept apart from the declarations
+	// so that finding those that name a changed global reads little memory.
+	using Name_filter = std::array<std::uint64_t, 4>;
+
+	std::vector<std::unique_ptr<Incremental_declaration>> m_declarations;
+	std::vector<Name_filter> m_filters;
+	Parser_context m_context;
+
+	// The symbol table keeps the globals of the declarations before this one
+	// from edit to edit, so typing in one place parses nothing else.
+	std::size_t m_prefix = 0;
+
+	std::uint64_t m_size = 0;
+	std::size_t m_reparsed = 0;
+
+	auto parse_declaration(std::size_t index) -> void;
+
+public:
+	// Interns names into atoms, or when null the process-wide pool, which keeps every name ever typed.
+	explicit Incremental_parser(std::string_view text, Atom_table* atoms = nullptr);
+
+	// Replaces removed bytes at offset with inserted.
+	auto edit(std::uint64_t offset, std::uint64_t removed, std::string_view inserted) -> void;
+
+	auto passed() const -> bool;
+
+	auto size() const -> std::size_t;
+	auto declaration(std::size_t index) const -> const Incremental_declaration&;
+
+	auto text() const -> std::string;
+	auto bytes() const -> std::uint64_t;
+
+	// Declarations parsed by the last edit.
+	auto reparsed() const -> std::size_t;
+};
+
+#endif
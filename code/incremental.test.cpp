@@ -0,0 +1,179 @@
+#include "corpus.h"
+#include "incremental.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Whether every declaration's tree is the matching part of the tree of a whole parse.
+	auto same_trees(const Incremental_parser& parser) -> bool
+	{
+		const std::string text = parser.text();
+		Parser_context whole;
+		if (!parse(whole, text.data(), text.data() + text.size()))
+		{
+			return false;
+		}
+
+		std::uint32_t node = 0;
+		std::uint32_t token = 0;
+		for (std::size_t i = 0; i < parser.size(); ++i)
+		{
+			const Incremental_declaration& declaration = parser.declaration(i);
+			for (const Node& part : declaration.nodes)
+			{
+				const Node& expected = whole.ast[node];
+				if (part.kind != expected.kind || part.token + token != expected.token || part.first + node - static_cast<std::uint32_t>(&part - declaration.nodes.data()) != expected.first)
+				{
+					return false;
+				}
+				++node;
+			}
+			token += declaration.tokens.size();
+		}
+		return node + 1 == whole.ast.size() && token == whole.tokens.size();
+	}
+
+	auto agrees(const Incremental_parser& parser, const std::string& text) -> bool
+	{
+		if (parser.text() != text || parser.bytes() != text.size())
+		{
+			return false;
+		}
+
+		const bool whole = parse(text.data(), text.data() + text.size());
+		return parser.passed() == whole && (!whole || same_trees(parser));
+	}
+}
+
+TEST_CASE("Incremental parse agrees with a whole parse", "[incremental]")
+{
+	const std::vector<std::string> snippets = {
+		"", "{", "}", ";", "x", " ", "\n", "int ", "// c\n", "(", ")", "/", "struct pair_0;", "typedef int T;", "int f() { }", "};", "int g();", "x = 1; ",
+	};
+
+	std::string text = generate_corpus(4 * 1024);
+	Incremental_parser parser(text);
+	REQUIRE(agrees(parser, text));
+
+	std::mt19937 random(42);
+	for (int i = 0; i < 1000; ++i)
+	{
+		const std::size_t offset = random() % (text.size() + 1);
+		const std::size_t removed = std::min<std::size_t>(random() % 8, text.size() - offset);
+		const std::string& inserted = snippets[random() % snippets.size()];
+		CAPTURE(i, offset, removed, inserted);
+
+		const std::string original = text.substr(offset, removed);
+		text.replace(offset, removed, inserted);
+		parser.edit(offset, removed, inserted);
+		REQUIRE(agrees(parser, text));
+
+		// Undoing the edits that break the input keeps it parsing, so the trees are compared too.
+		if (!parser.passed())
+		{
+			text.replace(offset, inserted.size(), original);
+			parser.edit(offset, inserted.size(), original);
+			REQUIRE(agrees(parser, text));
+		}
+	}
+}
+
+TEST_CASE("Incremental edits move declaration boundaries", "[incremental]")
+{
+	std::string text;
+	Incremental_parser parser(text);
+	REQUIRE(parser.passed());
+
+	// Typed a byte at a time, and so cut off along the way.
+	const std::string typed = "struct s { int x; };\nint f(s a) { return a.x; }\ns g();";
+	for (std::size_t i = 0; i < typed.size(); ++i)
+	{
+		parser.edit(i, 0, typed.substr(i, 1));
+		text += typed[i];
+		CAPTURE(text);
+		REQUIRE(agrees(parser, text));
+	}
+	REQUIRE(parser.size() == 3);
+
+	const auto edit = [&](std::size_t offset, std::size_t removed, const std::string& inserted) {
+		text.replace(offset, removed, inserted);
+		parser.edit(offset, removed, inserted);
+		CAPTURE(text);
+		REQUIRE(agrees(parser, text));
+	};
+
+	// An unbalanced brace joins everything after it into one declaration until it is closed.
+	const std::size_t brace = text.find("int f");
+	edit(brace, 0, "{ ");
+	REQUIRE(!parser.passed());
+	edit(brace, 2, "");
+	REQUIRE(parser.size() == 3);
+
+	// A ";" after a body belongs to it.
+	edit(text.find("s g"), 0, ";");
+	REQUIRE(parser.size() == 3);
+	edit(text.find(";s g"), 1, "");
+
+	// A comment swallowing the end of a declaration.
+	edit(text.find("int x;") + 5, 0, "//");
+	REQUIRE(!parser.passed());
+	edit(text.find("//"), 2, "");
+
+	edit(0, text.size(), "");
+	REQUIRE(parser.size() == 1);
+	REQUIRE(parser.passed());
+}
+
+TEST_CASE("Incremental edit reparses only what it changes", "[incremental]")
+{
+	std::string text = generate_corpus(64 * 1024);
+	Incremental_parser parser(text);
+	REQUIRE(parser.passed());
+	const std::size_t declarations = parser.size();
+
+	const auto edit = [&](std::size_t offset, std::size_t removed, const std::string& inserted) {
+		text.replace(offset, removed, inserted);
+		parser.edit(offset, removed, inserted);
+		REQUIRE(agrees(parser, text));
+	};
+
+	// Inside a body only the enclosing declaration is parsed again.
+	const std::size_t body = text.find("c = c + 1;", text.size() / 2);
+	edit(body, 0, "c = c * 3; ");
+	REQUIRE(parser.reparsed() == 1);
+	REQUIRE(parser.size() == declarations);
+
+	// Renaming a structure reparses the declarations that name it, which now fail.
+	const std::size_t name = text.find("struct pair_40\n");
+	edit(name + 13, 1, "9");
+	REQUIRE(parser.reparsed() > 1);
+	REQUIRE(parser.reparsed() < 10);
+	REQUIRE(!parser.passed());
+
+	edit(name + 13, 1, "0");
+	REQUIRE(parser.passed());
+}
+
+TEST_CASE("Incremental parse interns into its own table", "[incremental]")
+{
+	std::string text = "int f() { return 1; }";
+	Atom_table atoms;
+	Incremental_parser parser(text, &atoms);
+
+	const std::string inserted = " int incremental_test_scoped(int x) { return x; }";
+	text += inserted;
+	parser.edit(parser.bytes(), 0, inserted);
+
+	// Checked before a whole parse of the text interns the name in the pool.
+	const Incremental_declaration& declaration = parser.declaration(parser.size() - 1);
+	REQUIRE(atom_find("incremental_test_scoped") == null_atom);
+	REQUIRE(atoms.find("incremental_test_scoped") != null_atom);
+	REQUIRE(std::find(declaration.names.begin(), declaration.names.end(), atoms.find("incremental_test_scoped")) != declaration.names.end());
+	REQUIRE(agrees(parser, text));
+}
@@ -0,0 +1,40 @@
+#include "corpus.h"
+#include "location.h"
+#include "scan.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+TEST_CASE("Line index", "[benchmark]")
+{
+	const std::string input = generate_corpus(64 << 20);
+	const char* input_begin = input.data();
+	const char* input_end = input_begin + input.size();
+
+	for (const Scan_isa isa : {Scan_isa::scalar, Scan_isa::sse2, Scan_isa::avx2})
+	{
+		if (!scan_supported(isa))
+		{
+			continue;
+		}
+
+		const Scan_isa previous = scan_select(isa);
+		BENCHMARK("Index lines of 64 MiB, " + std::string(isa == Scan_isa::scalar ? "scalar" : isa == Scan_isa::sse2 ? "SSE2" : "AVX2"))
+		{
+			const Line_index index(input_begin, input_end);
+			return index.lines();
+		};
+		scan_select(previous);
+	}
+
+	const Line_index index(input_begin, input_end);
+	index.lines();
+	std::uint32_t offset = 0;
+	BENCHMARK("Locate an offset in 64 MiB")
+	{
+		offset = (offset + 0x9e3779b9u) % static_cast<std::uint32_t>(input.size());
+		return index.locate(offset).line;
+	};
+}
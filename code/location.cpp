@@ -0,0 +1,46 @@
+#include "location.h"
+
+#include "scan.h"
+
+#include <algorithm>
+#include <cassert>
+
+Line_index::Line_index(const char* begin, const char* end) :
+	m_begin(begin),
+	m_end(end)
+{
+}
+
+auto Line_index::build() const -> void
+{
+	scan_newlines(m_begin, m_end, m_newlines);
+	m_built = true;
+}
+
+auto Line_index::locate(std::uint32_t offset) const -> Location
+{
+	assert(offset <= static_cast<std::size_t>(m_end - m_begin));
+	if (!m_built)
+	{
+		build();
+	}
+
+	// The newlines before offset end the lines before its own.
+	const auto line = std::lower_bound(m_newlines.begin(), m_newlines.end(), offset);
+	const std::uint32_t line_begin = line == m_newlines.begin() ? 0 : *(line - 1) + 1;
+	return Location{static_cast<std::uint32_t>(line - m_newlines.begin()) + 1, offset - line_begin + 1};
+}
+
+auto Line_index::built() const -> bool
+{
+	return m_built;
+}
+
+auto Line_index::lines() const -> std::uint32_t
+{
+	if (!m_built)
+	{
+		build();
+	}
+	return static_cast<std::uint32_t>(m_newlines.size()) + 1;
+}
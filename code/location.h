@@ -0,0 +1,43 @@
+#ifndef EOP_LANG_LOCATION_H
+#define EOP_LANG_LOCATION_H
+
+#include <cstdint>
+#include <vector>
+
+// A position in the source, counted from 1; the column counts bytes.
+struct Location
+{
+	std::uint32_t line;
+	std::uint32_t column;
+};
+
+/*
+ * Maps byte offsets in an input to lines and columns.  The offsets of its
+ * newlines are found by one vectorized scan on the first query, so an input
+ * that is never asked about costs nothing; each query is then a binary
+ * search.  The input must outlive the index.  Queries on one index are not
+ * thread-safe, since the first one builds it.
+ */
+class Line_index
+{
+private:
+	const char* m_begin = nullptr;
+	const char* m_end = nullptr;
+	mutable std::vector<std::uint32_t> m_newlines;
+	mutable bool m_built = false;
+
+	auto build() const -> void;
+
+public:
+	Line_index() = default;
+	Line_index(const char* begin, const char* end);
+
+	// offset may be the size of the input, which is located after its last byte.
+	auto locate(std::uint32_t offset) const -> Location;
+
+	// Whether a query has built the index.
+	auto built() const -> bool;
+	auto lines() const -> std::uint32_t;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "allocations.h"
+#include "corpus.h"
+#include "location.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+TEST_CASE("Locate offsets", "[location]")
+{
+	const std::string input = "int f()\n{\n\n  return 1;\n}";
+	const Line_index index(input.data(), input.data() + input.size());
+
+	const auto located = [&index](std::uint32_t offset) {
+		const Location location = index.locate(offset);
+		return std::to_string(location.line) + ":" + std::to_string(location.column);
+	};
+	REQUIRE(located(0) == "1:1");
+	REQUIRE(located(4) == "1:5");
+	REQUIRE(located(7) == "1:8");
+	REQUIRE(located(8) == "2:1");
+	REQUIRE(located(10) == "3:1");
+	REQUIRE(located(13) == "4:3");
+	REQUIRE(located(input.size() - 1) == "5:1");
+	REQUIRE(located(input.size()) == "5:2");
+	REQUIRE(index.lines() == 5);
+
+	const Location position = index.locate(input.find("return"));
+	REQUIRE(position.line == 4);
+	REQUIRE(position.column == 3);
+}
+
+TEST_CASE("Locate in empty input and trailing newline", "[location]")
+{
+	const std::string empty;
+	const Line_index none(empty.data(), empty.data());
+	REQUIRE(none.locate(0).line == 1);
+	REQUIRE(none.locate(0).column == 1);
+	REQUIRE(none.lines() == 1);
+
+	const std::string input = "a\n";
+	const Line_index index(input.data(), input.data() + input.size());
+	REQUIRE(index.locate(2).line == 2);
+	REQUIRE(index.locate(2).column == 1);
+	REQUIRE(index.lines() == 2);
+}
+
+TEST_CASE("Locate agrees with counting newlines", "[location]")
+{
+	const std::string input = generate_corpus(64 * 1024);
+	const Line_index index(input.data(), input.data() + input.size());
+
+	std::uint32_t line = 1;
+	std::uint32_t column = 1;
+	for (std::uint32_t offset = 0; offset <= input.size(); ++offset)
+	{
+		const Location location = index.locate(offset);
+		REQUIRE(location.line == line);
+		REQUIRE(location.column == column);
+		if (offset < input.size() && input[offset] == '\n')
+		{
+			++line;
+			column = 1;
+		}
+		else
+		{
+			++column;
+		}
+	}
+}
+
+TEST_CASE("Line index is built on first query", "[location]")
+{
+	const std::string input = generate_corpus(64 * 1024);
+
+	start_counting_allocations();
+	{
+		const Line_index index(input.data(), input.data() + input.size());
+		REQUIRE(!index.built());
+	}
+	REQUIRE(stop_counting_allocations() == 0);
+
+	const Line_index index(input.data(), input.data() + input.size());
+	REQUIRE(index.locate(input.size()).line == index.lines());
+	REQUIRE(index.built());
+}
@@ -1,6 +1,326 @@
-#include <iostream>
+#include "parse_cache.h"
+#include "parser.h"
+#include "source_manager.h"
+#include "stream.h"
+#include "thread_pool.h"
 
-int main()
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace
 {
-	std::cout << "Hello, world!" << std::endl;
+	struct File_result
+	{
+		std::string path{};
+		std::string error{};
+		std::uint64_t bytes = 0;
+		std::uint64_t tokens = 0;
+		bool passed = false;
+		bool cached = false;
+
+		// The file's place in the sources, once loaded.
+		Source_id source{};
+
+		// The syntax errors in the order of the input, resolved to lines when reported.
+		std::vector<std::pair<Source_location, std::string>> diagnostics{};
+	};
+
+	auto usage() -> int
+	{
+		std::fprintf(stderr, "usage: eopc [-j threads] [--cache-dir directory] path...\n");
+		std::fprintf(stderr, "Parses each .eop file, searching directories recursively; - reads standard input\n");
+		std::fprintf(stderr, "a declaration at a time, reporting each one that fails as soon as it is read.\n");
+		std::fprintf(stderr, "With a cache directory, a file parsed before is read back instead of parsed again.\n");
+		return 2;
+	}
+
+	auto collect(const std::filesystem::path& path, std::vector<File_result>& files) -> bool
+	{
+		std::error_code error;
+		if (!std::filesystem::is_directory(path, error))
+		{
+			files.push_back(File_result{path.string()});
+			return true;
+		}
+
+		std::vector<std::string> found;
+		for (std::filesystem::recursive_directory_iterator iter(path, error), end; !error && iter != end; iter.increment(error))
+		{
+			if (iter->is_regular_file(error) && iter->path().extension() == ".eop")
+			{
+				found.push_back(iter->path().string());
+			}
+		}
+		if (error)
+		{
+			std::fprintf(stderr, "eopc: %s: %s\n", path.string().c_str(), error.message().c_str());
+			return false;
+		}
+
+		// Directory order is unspecified; sort so that the report is stable.
+		std::sort(found.begin(), found.end());
+		for (std::string& file : found)
+		{
+			files.push_back(File_result{std::move(file)});
+		}
+		return true;
+	}
+
+	// Files at least this large are lexed and parsed on the pool as well.
+	constexpr std::uint64_t s_parallel_bytes = 4 << 20;
+
+	// Standard input may be a generator still writing, so it is checked as it arrives.
+	auto parse_standard_input(File_result& result) -> void
+	{
+		Stream_parser parser([](const Stream_declaration& declaration, const Parser_context&) {
+			if (!declaration.parsed)
+			{
+				std::printf("FAIL -: declaration at bytes %llu-%llu\n",
+					static_cast<unsigned long long>(declaration.begin),
+					static_cast<unsigned long long>(declaration.end));
+				std::fflush(stdout);
+			}
+		});
+
+		if (parse_stream("-", parser, result.error))
+		{
+			result.passed = parser.passed();
+		}
+		result.bytes = parser.bytes();
+		result.tokens = parser.tokens();
+	}
+
+	auto construct_name(Construct construct) -> const char*
+	{
+		switch (construct)
+		{
+		case Construct::declaration: {
+			return "declaration";
+		}
+
+		case Construct::member: {
+			return "member";
+		}
+
+		case Construct::statement: {
+			return "statement";
+		}
+		}
+		return "construct";
+	}
+
+	auto describe(const Diagnostic& diagnostic, std::uint32_t offset, File_result& result) -> void
+	{
+		const char* construct = construct_name(diagnostic.construct);
+		result.diagnostics.emplace_back(result.source.manager->location(result.source.file, offset),
+			diagnostic.cut_off ? std::string("unexpected end of input in ") + construct : std::string(construct) + " does not parse");
+	}
+
+	// A hit leaves the file's bytes unlexed, reading only the diagnostics and their tokens.
+	auto find_cached(const Parse_cache& cache, std::uint64_t hash, File_result& result) -> bool
+	{
+		Cached_parse cached;
+		if (!cache.find(hash, result.bytes, cached))
+		{
+			return false;
+		}
+
+		for (std::uint32_t i = 0; !cached.passed() && i < cached.diagnostics(); ++i)
+		{
+			const Diagnostic diagnostic = cached.diagnostic(i);
+			describe(diagnostic, diagnostic.token < cached.tokens() ? cached.token_offset(diagnostic.token) : static_cast<std::uint32_t>(result.bytes), result);
+		}
+		result.passed = cached.passed();
+		result.tokens = cached.tokens();
+		result.cached = true;
+		return true;
+	}
+
+	auto parse_file(File_result& result, const Parse_cache* cache, Thread_pool& pool) -> void
+	{
+		if (result.path == "-")
+		{
+			parse_standard_input(result);
+			return;
+		}
+
+		if (!result.error.empty())
+		{
+			return;
+		}
+
+		// The sources keep the file open, so the tokens need not.
+		const char* begin = result.source.manager->begin(result.source.file);
+		const char* end = result.source.manager->end(result.source.file);
+		result.bytes = static_cast<std::uint64_t>(end - begin);
+
+		const std::uint64_t hash = cache ? Parse_cache::hash(begin, end) : 0;
+		if (cache && find_cached(*cache, hash, result))
+		{
+			return;
+		}
+
+		// One context per worker so its tables stay warm across files.
+		thread_local Parser_context context;
+
+		context.recover = result.bytes < s_parallel_bytes;
+		result.passed = context.recover ? parse(context, begin, end) : parse(context, begin, end, pool);
+		if (context.tokens.too_large())
+		{
+			result.error = "input larger than 4 GiB";
+			return;
+		}
+
+		// Only a serial parse recovers, so a large file with errors is reparsed to report them all.
+		if (!result.passed && !context.recover)
+		{
+			context.recover = true;
+			parse(context, begin, end);
+		}
+		// A passing file may still end cut off where parse accepts it; only failures are explained.
+		if (context.recover && !result.passed)
+		{
+			const Token_array& tokens = context.tokens.tokens();
+			for (const Diagnostic& diagnostic : context.diagnostics)
+			{
+				describe(diagnostic, diagnostic.token < tokens.size() ? tokens.offset(diagnostic.token) : static_cast<std::uint32_t>(result.bytes), result);
+			}
+		}
+		else
+		{
+			context.diagnostics.clear();
+		}
+		result.tokens = context.tokens.size();
+
+		// A cache that cannot be written only costs the next build a parse.
+		std::string error;
+		if (cache)
+		{
+			cache->store(hash, result.bytes, context, result.passed, error);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned threads = 0;
+	const char* cache_directory = nullptr;
+	std::vector<File_result> files;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "-j") == 0)
+		{
+			if (++i == argc)
+			{
+				return usage();
+			}
+			char* end;
+			const unsigned long n = std::strtoul(argv[i], &end, 10);
+			if (*end != '\0' || n == 0)
+			{
+				return usage();
+			}
+			threads = static_cast<unsigned>(n);
+		}
+		else if (std::strcmp(argv[i], "--cache-dir") == 0)
+		{
+			if (++i == argc)
+			{
+				return usage();
+			}
+			cache_directory = argv[i];
+		}
+		else if (!collect(argv[i], files))
+		{
+			return 1;
+		}
+	}
+
+	if (files.empty())
+	{
+		return usage();
+	}
+
+	std::unique_ptr<Parse_cache> cache;
+	if (cache_directory)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(cache_directory, error);
+		if (error)
+		{
+			std::fprintf(stderr, "eopc: %s: %s\n", cache_directory, error.message().c_str());
+			return 1;
+		}
+		cache = std::make_unique<Parse_cache>(cache_directory);
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	Source_set sources;
+	for (File_result& file : files)
+	{
+		if (file.path != "-")
+		{
+			sources.load(file.path.c_str(), file.source, file.error);
+		}
+	}
+	{
+		Thread_pool pool(threads);
+		for (File_result& file : files)
+		{
+			pool.submit([&file, &cache, &pool] { parse_file(file, cache.get(), pool); });
+		}
+		pool.wait();
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::uint64_t bytes = 0;
+	std::uint64_t tokens = 0;
+	std::size_t failed = 0;
+	std::size_t cached = 0;
+	for (const File_result& file : files)
+	{
+		if (!file.error.empty())
+		{
+			std::printf("FAIL %s: %s\n", file.path.c_str(), file.error.c_str());
+		}
+		else
+		{
+			std::printf("%s %s\n", file.passed ? "PASS" : "FAIL", file.path.c_str());
+			for (const auto& [location, message] : file.diagnostics)
+			{
+				const Presumed_location presumed = file.source.manager->resolve(location);
+				std::printf("%s:%u:%u: error: %s\n", file.source.manager->name(presumed.file).c_str(), presumed.location.line, presumed.location.column, message.c_str());
+			}
+		}
+		failed += !file.passed;
+		cached += file.cached;
+		bytes += file.bytes;
+		tokens += file.tokens;
+	}
+
+	const double seconds = elapsed.count() > 0.0 ? elapsed.count() : 1e-9;
+	std::printf("%zu files, %zu passed, %zu failed", files.size(), files.size() - failed, failed);
+	if (cache)
+	{
+		std::printf(", %zu from cache", cached);
+	}
+	std::printf("\n");
+	std::printf("%.3f MB, %llu tokens in %.3f s: %.1f MB/s, %.1f M tokens/s\n",
+		static_cast<double>(bytes) / 1e6,
+		static_cast<unsigned long long>(tokens),
+		seconds,
+		static_cast<double>(bytes) / 1e6 / seconds,
+		static_cast<double>(tokens) / 1e6 / seconds);
+
+	return failed == 0 ? 0 : 1;
 }
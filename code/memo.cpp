@@ -0,0 +1,103 @@
+#include "memo.h"
+
+#include <algorithm>
+
+static constexpr std::uint64_t s_empty_key = ~std::uint64_t(0);
+static constexpr std::size_t s_initial_slots = 64;
+
+static auto memo_key(Rule rule, std::uint32_t position) -> std::uint64_t
+{
+	return std::uint64_t(position) << 8 | static_cast<std::uint8_t>(rule);
+}
+
+Memo_table::Memo_table() :
+	m_slots(s_initial_slots, Slot{s_empty_key, {}})
+{
+}
+
+auto Memo_table::find_slot(std::uint64_t key) const -> std::size_t
+{
+	const std::size_t mask = m_slots.size() - 1;
+	for (std::size_t i = static_cast<std::size_t>((key * 0x9e3779b97f4a7c15u) >> 32) & mask; ; i = (i + 1) & mask)
+	{
+		if (m_slots[i].key == key || m_slots[i].key == s_empty_key)
+		{
+			return i;
+		}
+	}
+}
+
+auto Memo_table::grow() -> void
+{
+	std::vector<Slot> slots(m_slots.size() * 2, Slot{s_empty_key, {}});
+	slots.swap(m_slots);
+
+	for (const Slot& slot : slots)
+	{
+		if (slot.key != s_empty_key)
+		{
+			m_slots[find_slot(slot.key)] = slot;
+		}
+	}
+}
+
+auto Memo_table::clear() -> void
+{
+	std::fill(m_slots.begin(), m_slots.end(), Slot{s_empty_key, {}});
+	m_nodes.clear();
+	m_size = 0;
+}
+
+auto Memo_table::find(Rule rule, std::uint32_t position) const -> const Memo_entry*
+{
+	const Slot& slot = m_slots[find_slot(memo_key(rule, position))];
+	return slot.key == s_empty_key ? nullptr : &slot.entry;
+}
+
+auto Memo_table::insert(Rule rule, std::uint32_t position, bool parsed, std::uint32_t end, std::uint64_t state, const Ast& ast, std::uint32_t first) -> void
+{
+	const std::uint64_t key = memo_key(rule, position);
+	std::size_t index = find_slot(key);
+	if (m_slots[index].key == s_empty_key)
+	{
+		// Keep the load factor at or below one half.
+		if (2 * (m_size + 1) > m_slots.size())
+		{
+			grow();
+			index = find_slot(key);
+		}
+		++m_size;
+	}
+
+	// A stale entry being replaced leaves its nodes behind until the table is cleared.
+	const std::uint32_t node_begin = static_cast<std::uint32_t>(m_nodes.size());
+	for (std::uint32_t i = first; i < ast.size(); ++i)
+	{
+		Node node = ast[i];
+		node.first -= first;
+		m_nodes.push_back(node);
+	}
+
+	m_slots[index] = Slot{key, Memo_entry{parsed, end, state, node_begin, ast.size() - first}};
+}
+
+auto Memo_table::replay(const Memo_entry& entry, Ast& ast) const -> void
+{
+	const std::uint32_t first = ast.size();
+	for (std::uint32_t i = 0; i < entry.node_count; ++i)
+	{
+		Node node = m_nodes[entry.node_begin + i];
+		node.first += first;
+		ast.push_back(node);
+	}
+}
+
+auto Memo_table::size() const -> std::size_t
+{
+	return m_size;
+}
+
+auto Memo_table::bytes_reserved() const -> std::size_t
+{
+	return m_slots.capacity() * sizeof(Slot) + m_nodes.capacity() * sizeof(Node);
+}
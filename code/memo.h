@@ -0,0 +1,70 @@
+#ifndef EOP_LANG_MEMO_H
+#define EOP_LANG_MEMO_H
+
+#include "ast.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The parser rules whose outcomes are memoized, at the points where the parser backtracks.
+enum class Rule : std::uint8_t
+{
+	// The type or expression that begins a data member, apply or index operator.
+	member_expression,
+};
+
+struct Memo_entry
+{
+	bool parsed;
+	std::uint32_t end;
+
+	// Whatever else the outcome depends on; an entry only applies while it is unchanged.
+	std::uint64_t state;
+
+	// The nodes the rule emitted, with first relative to the rule's first node.
+	std::uint32_t node_begin;
+	std::uint32_t node_count;
+};
+
+/*
+ * Packrat memo table: the outcome of a rule at a token, so that trying it
+ * again after backtracking replays the outcome and its nodes instead of
+ * parsing the tokens again.  Open addressing on (rule, token), with the
+ * nodes of every entry in one array.
+ */
+class Memo_table
+{
+private:
+	struct Slot
+	{
+		std::uint64_t key;
+		Memo_entry entry;
+	};
+
+	std::vector<Slot> m_slots;
+	std::vector<Node> m_nodes;
+	std::size_t m_size = 0;
+
+	auto find_slot(std::uint64_t key) const -> std::size_t;
+	auto grow() -> void;
+
+public:
+	Memo_table();
+
+	// Keeps the memory for the next parse.
+	auto clear() -> void;
+
+	auto find(Rule rule, std::uint32_t position) const -> const Memo_entry*;
+
+	// Records the outcome of rule at position, which emitted ast's nodes from first on.
+	auto insert(Rule rule, std::uint32_t position, bool parsed, std::uint32_t end, std::uint64_t state, const Ast& ast, std::uint32_t first) -> void;
+
+	// Appends the entry's nodes to ast as if the rule had just emitted them.
+	auto replay(const Memo_entry& entry, Ast& ast) const -> void;
+
+	auto size() const -> std::size_t;
+	auto bytes_reserved() const -> std::size_t;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include "memo.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Memoize rule outcomes", "[memo]")
+{
+	Ast ast;
+	ast.push_back(Node{Node_kind::name, 0, 0});
+	ast.push_back(Node{Node_kind::name, 2, 1});
+	ast.push_back(Node{Node_kind::literal, 4, 2});
+	ast.push_back(Node{Node_kind::binary, 3, 1});
+
+	Memo_table memo;
+	REQUIRE(memo.find(Rule::member_expression, 2) == nullptr);
+	memo.insert(Rule::member_expression, 2, true, 5, 7, ast, 1);
+	memo.insert(Rule::member_expression, 9, false, 9, 7, ast, ast.size());
+	REQUIRE(memo.size() == 2);
+
+	const Memo_entry* entry = memo.find(Rule::member_expression, 2);
+	REQUIRE(entry != nullptr);
+	REQUIRE(entry->parsed);
+	REQUIRE(entry->end == 5);
+	REQUIRE(entry->state == 7);
+	REQUIRE(entry->node_count == 3);
+
+	// Replaying rebases the nodes onto wherever the tree now ends.
+	ast.truncate(1);
+	ast.push_back(Node{Node_kind::name, 1, 1});
+	memo.replay(*entry, ast);
+	REQUIRE(ast.size() == 5);
+	REQUIRE(ast[2].kind == Node_kind::name);
+	REQUIRE(ast[2].first == 2);
+	REQUIRE(ast[4].kind == Node_kind::binary);
+	REQUIRE(ast[4].first == 2);
+
+	const Memo_entry* failure = memo.find(Rule::member_expression, 9);
+	REQUIRE(failure != nullptr);
+	REQUIRE(!failure->parsed);
+	REQUIRE(failure->node_count == 0);
+
+	// Recording a rule again at the same position replaces its entry.
+	memo.insert(Rule::member_expression, 2, false, 3, 8, ast, ast.size());
+	REQUIRE(memo.size() == 2);
+	REQUIRE(memo.find(Rule::member_expression, 2)->state == 8);
+
+	memo.clear();
+	REQUIRE(memo.size() == 0);
+	REQUIRE(memo.find(Rule::member_expression, 9) == nullptr);
+}
+
+TEST_CASE("Memo table grows", "[memo]")
+{
+	Ast ast;
+	Memo_table memo;
+	for (std::uint32_t position = 0; position < 1000; ++position)
+	{
+		memo.insert(Rule::member_expression, position, position % 2 == 0, position + 1, 0, ast, 0);
+	}
+
+	REQUIRE(memo.size() == 1000);
+	for (std::uint32_t position = 0; position < 1000; ++position)
+	{
+		const Memo_entry* entry = memo.find(Rule::member_expression, position);
+		REQUIRE(entry != nullptr);
+		REQUIRE(entry->parsed == (position % 2 == 0));
+		REQUIRE(entry->end == position + 1);
+	}
+	REQUIRE(memo.bytes_reserved() >= 1000 * sizeof(Memo_entry));
+}
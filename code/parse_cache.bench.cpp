@@ -0,0 +1,49 @@
+#include "corpus.h"
+#include "parse_cache.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <string>
+
+TEST_CASE("Parse cache hit", "[benchmark]")
+{
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "eop_cache_bench";
+	std::filesystem::create_directories(directory);
+	const std::string input = generate_corpus(8 << 20);
+	const char* input_begin = input.data();
+	const char* input_end = input_begin + input.size();
+
+	Parser_context context;
+	REQUIRE(parse(context, input_begin, input_end));
+	const Parse_cache cache(directory.string());
+	std::string error;
+	REQUIRE(cache.store(Parse_cache::hash(input_begin, input_end), input.size(), context, true, error));
+
+	BENCHMARK("Parse 8 MiB")
+	{
+		return parse(context, input_begin, input_end);
+	};
+
+	BENCHMARK("Hash and find 8 MiB in the cache")
+	{
+		Cached_parse cached;
+		return cache.find(Parse_cache::hash(input_begin, input_end), input.size(), cached) && cached.passed();
+	};
+
+	// Reading every node touches the whole tree section of the entry.
+	BENCHMARK("Hash, find and walk the tree of 8 MiB")
+	{
+		Cached_parse cached;
+		cache.find(Parse_cache::hash(input_begin, input_end), input.size(), cached);
+		std::uint64_t sum = 0;
+		for (std::uint32_t i = 0; i < cached.nodes(); ++i)
+		{
+			sum += cached.node(i).token;
+		}
+		return sum;
+	};
+
+	std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,392 @@
+#include "parse_cache.h"
+
+#include "hash.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	constexpr char s_magic[8] = {'E', 'O', 'P', 'P', 'A', 'R', 'S', 'E'};
+
+	// Bump whenever the layout, the node kinds or the trees the parser builds change.
+	constexpr std::uint32_t s_version = 1;
+
+	constexpr std::size_t s_header_size = 56;
+	constexpr std::size_t s_node_size = 12;
+	constexpr std::size_t s_symbol_size = 12;
+	constexpr std::size_t s_diagnostic_size = 20;
+
+	struct Header
+	{
+		std::uint32_t version;
+		std::uint32_t flags;
+		std::uint64_t hash;
+		std::uint64_t size;
+		std::uint32_t tokens;
+		std::uint32_t nodes;
+		std::uint32_t symbols;
+		std::uint32_t diagnostics;
+		std::uint32_t names_size;
+	};
+
+	// Where each section starts, every one aligned to 8 bytes, and the size of the entry.
+	struct Layout
+	{
+		std::uint64_t kinds;
+		std::uint64_t offsets;
+		std::uint64_t lengths;
+		std::uint64_t nodes;
+		std::uint64_t symbols;
+		std::uint64_t diagnostics;
+		std::uint64_t names;
+		std::uint64_t size;
+	};
+
+	auto align(std::uint64_t offset) -> std::uint64_t
+	{
+		return (offset + 7) & ~std::uint64_t(7);
+	}
+
+	auto layout(const Header& header) -> Layout
+	{
+		Layout result;
+		result.kinds = s_header_size;
+		result.offsets = align(result.kinds + header.tokens);
+		result.lengths = align(result.offsets + std::uint64_t(4) * header.tokens);
+		result.nodes = align(result.lengths + std::uint64_t(4) * header.tokens);
+		result.symbols = align(result.nodes + s_node_size * header.nodes);
+		result.diagnostics = align(result.symbols + s_symbol_size * header.symbols);
+		result.names = align(result.diagnostics + s_diagnostic_size * header.diagnostics);
+		result.size = align(result.names + header.names_size);
+		return result;
+	}
+
+	template <typename T>
+	auto read(const char* p) -> T
+	{
+		T value;
+		std::memcpy(&value, p, sizeof(T));
+		return value;
+	}
+
+	template <typename T>
+	auto write(char* p, T value) -> void
+	{
+		std::memcpy(p, &value, sizeof(T));
+	}
+
+	auto read_header(const char* p) -> Header
+	{
+		return Header{
+			read<std::uint32_t>(p + 8),
+			read<std::uint32_t>(p + 12),
+			read<std::uint64_t>(p + 16),
+			read<std::uint64_t>(p + 24),
+			read<std::uint32_t>(p + 32),
+			read<std::uint32_t>(p + 36),
+			read<std::uint32_t>(p + 40),
+			read<std::uint32_t>(p + 44),
+			read<std::uint32_t>(p + 48),
+		};
+	}
+
+	auto write_header(char* p, const Header& header) -> void
+	{
+		std::memcpy(p, s_magic, sizeof(s_magic));
+		write(p + 8, header.version);
+		write(p + 12, header.flags);
+		write(p + 16, header.hash);
+		write(p + 24, header.size);
+		write(p + 32, header.tokens);
+		write(p + 36, header.nodes);
+		write(p + 40, header.symbols);
+		write(p + 44, header.diagnostics);
+		write(p + 48, header.names_size);
+	}
+
+	// The node that names a top-level declaration, looking inside a template.
+	auto declared(const Ast& ast, std::uint32_t index) -> std::uint32_t
+	{
+		return ast[index].kind == Node_kind::template_declaration ? index - 1 : index;
+	}
+}
+
+auto Cached_parse::passed() const -> bool
+{
+	return m_passed;
+}
+
+auto Cached_parse::tokens() const -> std::uint32_t
+{
+	return m_tokens;
+}
+
+auto Cached_parse::token_kind(std::uint32_t index) const -> Token_kind
+{
+	if (index >= m_tokens)
+	{
+		return Token_kind::invalid;
+	}
+
+	// keyword_while is the last kind.
+	const auto kind = static_cast<Token_kind>(m_kinds[index]);
+	return kind > Token_kind::keyword_while ? Token_kind::invalid : kind;
+}
+
+auto Cached_parse::token_offset(std::uint32_t index) const -> std::uint32_t
+{
+	if (index >= m_tokens)
+	{
+		return 0;
+	}
+	return read<std::uint32_t>(m_offsets + std::size_t(4) * index);
+}
+
+auto Cached_parse::token_length(std::uint32_t index) const -> std::uint32_t
+{
+	if (index >= m_tokens)
+	{
+		return 0;
+	}
+	return read<std::uint32_t>(m_lengths + std::size_t(4) * index);
+}
+
+auto Cached_parse::nodes() const -> std::uint32_t
+{
+	return m_nodes;
+}
+
+auto Cached_parse::node(std::uint32_t index) const -> Node
+{
+	// A damaged node reads as a childless error node, so a walk of the tree stays inside it.
+	const Node damaged{Node_kind::error, 0, index};
+	if (index >= m_nodes)
+	{
+		return damaged;
+	}
+
+	const char* p = m_node_data + s_node_size * index;
+	const Node node{static_cast<Node_kind>(p[8]), read<std::uint32_t>(p), read<std::uint32_t>(p + 4)};
+	if (node.kind > Node_kind::unit || node.token > m_tokens || node.first > index)
+	{
+		return damaged;
+	}
+	return node;
+}
+
+auto Cached_parse::symbols() const -> std::uint32_t
+{
+	return m_symbols;
+}
+
+auto Cached_parse::symbol(std::uint32_t index) const -> Cached_symbol
+{
+	if (index >= m_symbols)
+	{
+		return Cached_symbol{m_nodes, std::string_view()};
+	}
+
+	const char* p = m_symbol_data + s_symbol_size * index;
+	const auto offset = read<std::uint32_t>(p + 4);
+	const auto length = read<std::uint32_t>(p + 8);
+
+	// A damaged entry must not send the name outside the mapping.
+	if (std::uint64_t(offset) + length > m_names_size)
+	{
+		return Cached_symbol{read<std::uint32_t>(p), std::string_view()};
+	}
+	return Cached_symbol{read<std::uint32_t>(p), std::string_view(m_names + offset, length)};
+}
+
+auto Cached_parse::diagnostics() const -> std::uint32_t
+{
+	return m_diagnostics;
+}
+
+auto Cached_parse::diagnostic(std::uint32_t index) const -> Diagnostic
+{
+	if (index >= m_diagnostics)
+	{
+		return Diagnostic{Construct::declaration, m_tokens, m_tokens, m_tokens, true};
+	}
+
+	const char* p = m_diagnostic_data + s_diagnostic_size * index;
+	return Diagnostic{
+		static_cast<Construct>(read<std::uint32_t>(p)),
+		read<std::uint32_t>(p + 4),
+		read<std::uint32_t>(p + 8),
+		read<std::uint32_t>(p + 12),
+		read<std::uint32_t>(p + 16) != 0,
+	};
+}
+
+Parse_cache::Parse_cache(std::string directory) :
+	m_directory(std::move(directory))
+{
+}
+
+auto Parse_cache::path(std::uint64_t hash) const -> std::string
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.eopc", static_cast<unsigned long long>(hash));
+	return (std::filesystem::path(m_directory) / name).string();
+}
+
+auto Parse_cache::hash(const char* begin, const char* end) -> std::uint64_t
+{
+	return xxhash64(begin, static_cast<std::size_t>(end - begin));
+}
+
+auto Parse_cache::find(std::uint64_t hash, std::uint64_t size, Cached_parse& parse) const -> bool
+{
+	Source_file file;
+	std::string error;
+	if (!file.open(path(hash).c_str(), error) || file.size() < s_header_size)
+	{
+		return false;
+	}
+
+	const char* data = file.begin();
+	const Header header = read_header(data);
+	if (std::memcmp(data, s_magic, sizeof(s_magic)) != 0 || header.version != s_version || header.hash != hash || header.size != size)
+	{
+		return false;
+	}
+
+	const Layout sections = layout(header);
+	if (sections.size != file.size())
+	{
+		return false;
+	}
+
+	parse.m_passed = (header.flags & 1) != 0;
+	parse.m_tokens = header.tokens;
+	parse.m_nodes = header.nodes;
+	parse.m_symbols = header.symbols;
+	parse.m_diagnostics = header.diagnostics;
+	parse.m_kinds = data + sections.kinds;
+	parse.m_offsets = data + sections.offsets;
+	parse.m_lengths = data + sections.lengths;
+	parse.m_node_data = data + sections.nodes;
+	parse.m_symbol_data = data + sections.symbols;
+	parse.m_diagnostic_data = data + sections.diagnostics;
+	parse.m_names = data + sections.names;
+	parse.m_names_size = header.names_size;
+	parse.m_file = std::move(file);
+	return true;
+}
+
+auto Parse_cache::store(std::uint64_t hash, std::uint64_t size, const Parser_context& context, bool passed, std::string& error) const -> bool
+{
+	const Token_buffer& tokens = context.tokens;
+	const Ast& ast = context.ast;
+
+	// The top-level declarations are the children of the unit, when the parse got that far.
+	std::vector<std::uint32_t> declarations;
+	if (!ast.empty() && ast[ast.size() - 1].kind == Node_kind::unit)
+	{
+		for (const std::uint32_t child : ast.children(ast.size() - 1))
+		{
+			if (ast[child].kind != Node_kind::error)
+			{
+				declarations.push_back(child);
+			}
+		}
+	}
+
+	std::uint64_t names_size = 0;
+	for (const std::uint32_t declaration : declarations)
+	{
+		names_size += tokens.tokens().length(ast[declared(ast, declaration)].token);
+	}
+
+	Header header{};
+	header.version = s_version;
+	header.flags = passed ? 1 : 0;
+	header.hash = hash;
+	header.size = size;
+	header.tokens = tokens.size();
+	header.nodes = ast.size();
+	header.symbols = static_cast<std::uint32_t>(declarations.size());
+	header.diagnostics = static_cast<std::uint32_t>(context.diagnostics.size());
+	header.names_size = static_cast<std::uint32_t>(names_size);
+	const Layout sections = layout(header);
+
+	std::vector<char> entry(sections.size, 0);
+	char* data = entry.data();
+	write_header(data, header);
+	for (std::uint32_t i = 0; i < header.tokens; ++i)
+	{
+		data[sections.kinds + i] = static_cast<char>(tokens.kind(i));
+		write(data + sections.offsets + std::size_t(4) * i, tokens.tokens().offset(i));
+		write(data + sections.lengths + std::size_t(4) * i, tokens.tokens().length(i));
+	}
+
+	for (std::uint32_t i = 0; i < header.nodes; ++i)
+	{
+		char* p = data + sections.nodes + s_node_size * i;
+		write(p, ast[i].token);
+		write(p + 4, ast[i].first);
+		p[8] = static_cast<char>(ast[i].kind);
+	}
+
+	std::uint32_t name_offset = 0;
+	for (std::uint32_t i = 0; i < header.symbols; ++i)
+	{
+		const std::uint32_t node = declared(ast, declarations[i]);
+		const Token token = tokens.token(ast[node].token);
+		const auto length = static_cast<std::uint32_t>(token.end - token.begin);
+		char* p = data + sections.symbols + s_symbol_size * i;
+		write(p, declarations[i]);
+		write(p + 4, name_offset);
+		write(p + 8, length);
+		std::memcpy(data + sections.names + name_offset, token.begin, length);
+		name_offset += length;
+	}
+
+	for (std::uint32_t i = 0; i < header.diagnostics; ++i)
+	{
+		const Diagnostic& diagnostic = context.diagnostics[i];
+		char* p = data + sections.diagnostics + s_diagnostic_size * i;
+		write(p, static_cast<std::uint32_t>(diagnostic.construct));
+		write(p + 4, diagnostic.token);
+		write(p + 8, diagnostic.begin);
+		write(p + 12, diagnostic.end);
+		write(p + 16, static_cast<std::uint32_t>(diagnostic.cut_off));
+	}
+
+	// A name of its own for each writer, so that a rename only ever installs a whole entry.
+	const std::string target = path(hash);
+	const std::string temporary = target + "." + std::to_string(std::random_device()()) + ".tmp";
+	std::FILE* file = std::fopen(temporary.c_str(), "wb");
+	if (!file)
+	{
+		error = std::strerror(errno);
+		return false;
+	}
+
+	const bool written = std::fwrite(entry.data(), 1, entry.size(), file) == entry.size();
+	if (std::fclose(file) != 0 || !written)
+	{
+		error = "cannot write cache entry";
+		std::remove(temporary.c_str());
+		return false;
+	}
+
+	std::error_code code;
+	std::filesystem::rename(temporary, target, code);
+	if (code)
+	{
+		error = code.message();
+		std::remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
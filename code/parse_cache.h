@@ -0,0 +1,100 @@
+#ifndef EOP_LANG_PARSE_CACHE_H
+#define EOP_LANG_PARSE_CACHE_H
+
+#include "ast.h"
+#include "parser.h"
+#include "source_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// A top-level declaration of a cached parse: its node and declared name.
+struct Cached_symbol
+{
+	std::uint32_t node;
+	std::string_view name;
+};
+
+/*
+ * A parse read back from the cache.  The entry file is mapped, not read,
+ * and every accessor reads the mapping in place, so only the pages of what
+ * is used are ever loaded.  The sections hold fixed-width fields at offsets
+ * computed from the counts in the header, so the entry holds no pointers
+ * and is valid wherever it is mapped.
+ *
+ * Reading the entry lazily means its body is never checked whole, so an
+ * entry damaged within its size is still found.  Instead every accessor
+ * checks the index it is given: out of range, it reads as an invalid token,
+ * a childless error node, an empty symbol or a cut-off diagnostic, as does
+ * a token or node whose kind or indices are out of range.  Following any
+ * index an entry holds therefore never reads outside the mapping.
+ */
+class Cached_parse
+{
+private:
+	Source_file m_file;
+	bool m_passed = false;
+	std::uint32_t m_tokens = 0;
+	std::uint32_t m_nodes = 0;
+	std::uint32_t m_symbols = 0;
+	std::uint32_t m_diagnostics = 0;
+	const char* m_kinds = nullptr;
+	const char* m_offsets = nullptr;
+	const char* m_lengths = nullptr;
+	const char* m_node_data = nullptr;
+	const char* m_symbol_data = nullptr;
+	const char* m_diagnostic_data = nullptr;
+	const char* m_names = nullptr;
+	std::uint32_t m_names_size = 0;
+
+	friend class Parse_cache;
+
+public:
+	// Whether parse returned true; a failed parse keeps the diagnostics of a recovering parse.
+	auto passed() const -> bool;
+
+	auto tokens() const -> std::uint32_t;
+	auto token_kind(std::uint32_t index) const -> Token_kind;
+	auto token_offset(std::uint32_t index) const -> std::uint32_t;
+	auto token_length(std::uint32_t index) const -> std::uint32_t;
+
+	auto nodes() const -> std::uint32_t;
+	auto node(std::uint32_t index) const -> Node;
+
+	auto symbols() const -> std::uint32_t;
+	auto symbol(std::uint32_t index) const -> Cached_symbol;
+
+	auto diagnostics() const -> std::uint32_t;
+	auto diagnostic(std::uint32_t index) const -> Diagnostic;
+};
+
+/*
+ * Parse results stored on disk, one file per input named by a hash of its
+ * contents, so an unchanged input is found again without lexing or parsing
+ * it.  An entry also records the size of its input and the format version;
+ * one that does not match, or is cut short, is a miss.  Entries are written
+ * to a temporary file and renamed into place, so concurrent builds sharing
+ * a directory never see one half written.
+ */
+class Parse_cache
+{
+private:
+	std::string m_directory;
+
+	auto path(std::uint64_t hash) const -> std::string;
+
+public:
+	explicit Parse_cache(std::string directory);
+
+	// The key of an input for find and store.
+	static auto hash(const char* begin, const char* end) -> std::uint64_t;
+
+	auto find(std::uint64_t hash, std::uint64_t size, Cached_parse& parse) const -> bool;
+
+	// Stores the tokens, tree and diagnostics of a parse of an input of the given size.
+	auto store(std::uint64_t hash, std::uint64_t size, const Parser_context& context, bool passed, std::string& error) const -> bool;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "corpus.h"
+#include "parse_cache.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace
+{
+	// A fresh, empty directory for each test.
+	auto cache_directory(const char* name) -> std::string
+	{
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+		std::filesystem::remove_all(path);
+		std::filesystem::create_directories(path);
+		return path.string();
+	}
+}
+
+TEST_CASE("Cache round trips a parse", "[parse cache]")
+{
+	const std::string directory = cache_directory("eop_cache_round_trip");
+	const std::string input = generate_corpus(64 * 1024);
+	const char* begin = input.data();
+	const char* end = begin + input.size();
+
+	Parser_context context;
+	REQUIRE(parse(context, begin, end));
+
+	const Parse_cache cache(directory);
+	const std::uint64_t hash = Parse_cache::hash(begin, end);
+	Cached_parse cached;
+	REQUIRE(!cache.find(hash, input.size(), cached));
+
+	std::string error;
+	REQUIRE(cache.store(hash, input.size(), context, true, error));
+	REQUIRE(cache.find(hash, input.size(), cached));
+
+	REQUIRE(cached.passed());
+	REQUIRE(cached.diagnostics() == 0);
+	REQUIRE(cached.tokens() == context.tokens.size());
+	for (std::uint32_t i = 0; i < cached.tokens(); ++i)
+	{
+		REQUIRE(cached.token_kind(i) == context.tokens.kind(i));
+		REQUIRE(cached.token_offset(i) == context.tokens.tokens().offset(i));
+		REQUIRE(cached.token_length(i) == context.tokens.tokens().length(i));
+	}
+
+	REQUIRE(cached.nodes() == context.ast.size());
+	for (std::uint32_t i = 0; i < cached.nodes(); ++i)
+	{
+		const Node node = cached.node(i);
+		REQUIRE(node.kind == context.ast[i].kind);
+		REQUIRE(node.token == context.ast[i].token);
+		REQUIRE(node.first == context.ast[i].first);
+	}
+
+	// A symbol for each top-level declaration, named as in the source.
+	const std::vector<std::uint32_t> declarations = context.ast.children(context.ast.size() - 1);
+	REQUIRE(cached.symbols() == declarations.size());
+	for (std::uint32_t i = 0; i < cached.symbols(); ++i)
+	{
+		const Cached_symbol symbol = cached.symbol(i);
+		REQUIRE(symbol.node == declarations[i]);
+		const std::uint32_t named = context.ast[symbol.node].kind == Node_kind::template_declaration ? symbol.node - 1 : symbol.node;
+		const Token token = context.tokens.token(context.ast[named].token);
+		REQUIRE(symbol.name == std::string_view(token.begin, static_cast<std::size_t>(token.end - token.begin)));
+	}
+
+	std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Cache keeps diagnostics", "[parse cache]")
+{
+	const std::string directory = cache_directory("eop_cache_diagnostics");
+	const std::string input = "int f() { x = ; } struct s { int a; } template <typename T> int g(T x) { }";
+
+	Parser_context context;
+	context.recover = true;
+	REQUIRE(!parse(context, input.data(), input.data() + input.size()));
+	REQUIRE(!context.diagnostics.empty());
+
+	const Parse_cache cache(directory);
+	const std::uint64_t hash = Parse_cache::hash(input.data(), input.data() + input.size());
+	std::string error;
+	REQUIRE(cache.store(hash, input.size(), context, false, error));
+
+	Cached_parse cached;
+	REQUIRE(cache.find(hash, input.size(), cached));
+	REQUIRE(!cached.passed());
+	REQUIRE(cached.diagnostics() == context.diagnostics.size());
+	for (std::uint32_t i = 0; i < cached.diagnostics(); ++i)
+	{
+		const Diagnostic diagnostic = cached.diagnostic(i);
+		REQUIRE(diagnostic.construct == context.diagnostics[i].construct);
+		REQUIRE(diagnostic.token == context.diagnostics[i].token);
+		REQUIRE(diagnostic.begin == context.diagnostics[i].begin);
+		REQUIRE(diagnostic.end == context.diagnostics[i].end);
+		REQUIRE(diagnostic.cut_off == context.diagnostics[i].cut_off);
+	}
+	REQUIRE(cached.symbols() == 2);
+	REQUIRE(cached.symbol(0).name == "f");
+	REQUIRE(cached.symbol(1).name == "g");
+
+	std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Cache misses on a mismatched or damaged entry", "[parse cache]")
+{
+	const std::string directory = cache_directory("eop_cache_damaged");
+	const std::string input = "int f() { return 1; }";
+
+	Parser_context context;
+	REQUIRE(parse(context, input.data(), input.data() + input.size()));
+
+	const Parse_cache cache(directory);
+	const std::uint64_t hash = Parse_cache::hash(input.data(), input.data() + input.size());
+	std::string error;
+	REQUIRE(cache.store(hash, input.size(), context, true, error));
+
+	Cached_parse cached;
+	REQUIRE(!cache.find(hash, input.size() + 1, cached));
+	REQUIRE(!cache.find(hash + 1, input.size(), cached));
+
+	// Only the entry itself is left, with no temporary files beside it.
+	std::filesystem::path entry;
+	std::size_t entries = 0;
+	for (const auto& file : std::filesystem::directory_iterator(directory))
+	{
+		entry = file.path();
+		++entries;
+	}
+	REQUIRE(entries == 1);
+
+	std::filesystem::resize_file(entry, std::filesystem::file_size(entry) - 8);
+	REQUIRE(!cache.find(hash, input.size(), cached));
+
+	std::ofstream(entry, std::ios::binary) << "EOPPARSE";
+	REQUIRE(!cache.find(hash, input.size(), cached));
+
+	std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Damaged entry reads stay inside it", "[parse cache]")
+{
+	const std::string directory = cache_directory("eop_cache_damaged_body");
+	const std::string input = "int f() { return 1; } struct s { int a; };";
+
+	Parser_context context;
+	REQUIRE(parse(context, input.data(), input.data() + input.size()));
+
+	const Parse_cache cache(directory);
+	const std::uint64_t hash = Parse_cache::hash(input.data(), input.data() + input.size());
+	std::string error;
+	REQUIRE(cache.store(hash, input.size(), context, true, error));
+
+	// Every byte past the 56-byte header set, so the entry is found but every index in it is wild.
+	const std::filesystem::path entry = std::filesystem::directory_iterator(directory)->path();
+	const auto size = static_cast<std::size_t>(std::filesystem::file_size(entry));
+	std::string bytes(size, '\0');
+	std::ifstream(entry, std::ios::binary).read(&bytes[0], static_cast<std::streamsize>(size));
+	std::fill(bytes.begin() + 56, bytes.end(), '\xff');
+	std::ofstream(entry, std::ios::binary).write(bytes.data(), static_cast<std::streamsize>(size));
+
+	Cached_parse cached;
+	REQUIRE(cache.find(hash, input.size(), cached));
+	REQUIRE(cached.nodes() == context.ast.size());
+	for (std::uint32_t i = 0; i < cached.nodes(); ++i)
+	{
+		const Node node = cached.node(i);
+		REQUIRE(node.kind == Node_kind::error);
+		REQUIRE(node.first == i);
+		REQUIRE(cached.token_kind(node.token) == Token_kind::invalid);
+	}
+
+	for (std::uint32_t i = 0; i < cached.symbols(); ++i)
+	{
+		const Cached_symbol symbol = cached.symbol(i);
+		REQUIRE(symbol.name.empty());
+		REQUIRE(cached.node(symbol.node).kind == Node_kind::error);
+	}
+
+	REQUIRE(cached.token_kind(cached.tokens()) == Token_kind::invalid);
+	REQUIRE(cached.token_offset(0xffffffff) == 0);
+	REQUIRE(cached.token_length(0xffffffff) == 0);
+	REQUIRE(cached.node(0xffffffff).kind == Node_kind::error);
+
+	std::filesystem::remove_all(directory);
+}
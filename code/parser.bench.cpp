@@ -0,0 +1,280 @@
+#include "corpus.h"
+#include "parser.h"
+#include "thread_pool.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Parse throughput", "[benchmark]")
+{
+	const std::string input = generate_corpus(1 << 20);
+	const char* input_begin = input.data();
+	const char* input_end = input_begin + input.size();
+	REQUIRE(parse(input_begin, input_end));
+
+	BENCHMARK("Parse 1 MiB")
+	{
+		return parse(input_begin, input_end);
+	};
+
+	Parser_context context;
+	BENCHMARK("Parse interface of 1 MiB")
+	{
+		return parse_interface(context, input_begin, input_end);
+	};
+}
+
+TEST_CASE("Parallel parse scaling", "[benchmark]")
+{
+	const std::string input = generate_corpus(16 << 20);
+	const char* input_begin = input.data();
+	const char* input_end = input_begin + input.size();
+
+	Parser_context context;
+	BENCHMARK("Parse 16 MiB serially")
+	{
+		return parse(context, input_begin, input_end);
+	};
+
+	std::vector<unsigned> thread_counts;
+	const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned threads = 1; threads < hardware; threads *= 2)
+	{
+		thread_counts.push_back(threads);
+	}
+	thread_counts.push_back(hardware);
+
+	for (const unsigned threads : thread_counts)
+	{
+		Thread_pool pool(threads);
+		BENCHMARK("Parse 16 MiB on " + std::to_string(threads) + " threads")
+		{
+			return parse(context, input_begin, input_end, pool);
+		};
+	}
+}
+
+TEST_CASE("Syntax tree throughput", "[benchmark]")
+{
+	const std::string input = generate_corpus(16 << 20);
+	const char* input_begin = input.data();
+	const char* input_end = input_begin + input.size();
+
+	Parser_context context;
+	REQUIRE(parse(context, input_begin, input_end));
+
+	double seconds = 1e9;
+	for (int i = 0; i < 5; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		parse(context, input_begin, input_end);
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		seconds = std::min(seconds, elapsed.count());
+	}
+
+	const double nodes = context.ast.size();
+	std::printf("%.0f nodes from %u tokens: %.1f M nodes/s, %zu bytes per node, %.2f bytes per node reserved\n",
+		nodes,
+		context.tokens.size(),
+		nodes / seconds / 1e6,
+		sizeof(Node),
+		static_cast<double>(context.ast.bytes_reserved()) / nodes);
+
+	BENCHMARK("Parse 16 MiB into a tree")
+	{
+		return parse(context, input_begin, input_end);
+	};
+}
+
+namespace
+{
+	class Procedure_names : public Parse_events
+	{
+	public:
+		std::uint64_t procedures = 0;
+		std::uint64_t parameters = 0;
+
+		auto on_procedure_end(const Token_buffer&, std::uint32_t, std::uint32_t count) -> void override
+		{
+			++procedures;
+			parameters += count;
+		}
+	};
+}
+
+TEST_CASE("Event parse throughput", "[benchmark]")
+{
+	const std::string input = generate_corpus(1 << 20);
+	const char* input_begin = input.data();
+	const char* input_end = input_begin + input.size();
+
+	Parser_context context;
+	Parse_events nothing;
+	Procedure_names names;
+	REQUIRE(parse(context, input_begin, input_end, names));
+
+	BENCHMARK("Parse 1 MiB into a tree")
+	{
+		return parse(context, input_begin, input_end);
+	};
+
+	BENCHMARK("Parse 1 MiB into empty events")
+	{
+		return parse(context, input_begin, input_end, nothing);
+	};
+
+	BENCHMARK("Parse 1 MiB into procedure events")
+	{
+		return parse(context, input_begin, input_end, names);
+	};
+
+	BENCHMARK("Parse lexed 1 MiB into procedure events")
+	{
+		return parse(context, names);
+	};
+}
+
+TEST_CASE("Expression parser comparison", "[benchmark]")
+{
+	std::string input;
+	for (std::size_t n = 0; input.size() < (1 << 20); ++n)
+	{
+		input += "int expression_" + std::to_string(n) + "(int a, int b, int c)\n"
+			"{\n"
+			"\treturn a * b + c - (a % c) / b < a + 1 && b >= c || !(a == b) && c != 0;\n"
+			"}\n\n";
+	}
+	const std::string nested = "int f(int x) { return " + std::string(1000, '(') + "x" + std::string(1000, ')') + "; }";
+
+	for (const Expressions expressions : {Expressions::descent, Expressions::climbing})
+	{
+		const char* name = expressions == Expressions::climbing ? "precedence climbing" : "recursive descent";
+
+		Parser_context context;
+		context.expressions = expressions;
+		const char base = 0;
+		REQUIRE(parse(context, nested.data(), nested.data() + nested.size()));
+		const double depth_bytes = static_cast<double>(reinterpret_cast<std::uintptr_t>(&base) - context.stack_low);
+		std::printf("%s: %.0f stack bytes per nested parenthesis\n", name, depth_bytes / 1000);
+
+		REQUIRE(parse(context, input.data(), input.data() + input.size()));
+		BENCHMARK(std::string("Parse 1 MiB of expressions by ") + name)
+		{
+			return parse(context, input.data(), input.data() + input.size());
+		};
+	}
+}
+
+TEST_CASE("Memoized parse of pathological members", "[benchmark]")
+{
+	// Each index operator's leading expression is parsed as a data member, an apply operator and an index operator.
+	for (const std::size_t terms : {1, 64, 4096})
+	{
+		std::string member = "a";
+		for (std::size_t i = 1; i < terms; ++i)
+		{
+			member += " + a";
+		}
+		member += " operator[](int i) { return i; }\n";
+
+		std::string input;
+		for (std::size_t n = 0; input.size() < (1 << 20); ++n)
+		{
+			input += "struct s_" + std::to_string(n) + "\n{\n";
+			for (int i = 0; i < 8; ++i)
+			{
+				input += member;
+			}
+			input += "};\n\n";
+		}
+		const char* input_begin = input.data();
+		const char* input_end = input_begin + input.size();
+
+		for (const bool memoize : {false, true})
+		{
+			Parser_context context;
+			context.memoize = memoize;
+			REQUIRE(parse(context, input_begin, input_end));
+			std::printf("%zu terms per member, memoization %s: %.2f visits per token, %.2f memo bytes per token\n",
+				terms,
+				memoize ? "on" : "off",
+				static_cast<double>(context.visited) / context.tokens.size(),
+				static_cast<double>(memoize ? context.memo.bytes_reserved() : 0) / context.tokens.size());
+
+			BENCHMARK("Parse 1 MiB of " + std::to_string(terms) + "-term members, memoization " + (memoize ? "on" : "off"))
+			{
+				return parse(context, input_begin, input_end);
+			};
+		}
+	}
+
+	const std::string corpus = generate_corpus(1 << 20);
+	Parser_context context;
+	context.memoize = true;
+	BENCHMARK("Parse 1 MiB with memoization")
+	{
+		return parse(context, corpus.data(), corpus.data() + corpus.size());
+	};
+}
+
+TEST_CASE("Deeply nested parse", "[benchmark]")
+{
+	for (const int depth : {10, 1000, 100000})
+	{
+		std::string statements = "int f(int x) { ";
+		for (int i = 0; i < depth; ++i)
+		{
+			statements += "if (x) { ";
+		}
+		statements += "x = 1;" + std::string(depth, '}') + " }";
+		const std::string parentheses = "int f(int x) { return " + std::string(depth, '(') + "x" + std::string(depth, ')') + "; }";
+
+		Parser_context context;
+		REQUIRE(parse(context, statements.data(), statements.data() + statements.size()));
+		REQUIRE(parse(context, parentheses.data(), parentheses.data() + parentheses.size()));
+
+		BENCHMARK("Parse statements nested " + std::to_string(depth) + " deep")
+		{
+			return parse(context, statements.data(), statements.data() + statements.size());
+		};
+
+		BENCHMARK("Parse parentheses nested " + std::to_string(depth) + " deep")
+		{
+			return parse(context, parentheses.data(), parentheses.data() + parentheses.size());
+		};
+	}
+}
+
+TEST_CASE("Recovering parse throughput", "[benchmark]")
+{
+	const std::string valid = generate_corpus(1 << 20);
+	std::string broken = valid;
+	for (std::size_t i = broken.find(" = "); i != std::string::npos; i = broken.find(" = ", i + 3))
+	{
+		broken.replace(i, 3, " = = ");
+	}
+
+	Parser_context context;
+	context.recover = true;
+	REQUIRE(parse(context, valid.data(), valid.data() + valid.size()));
+	REQUIRE(!parse(context, broken.data(), broken.data() + broken.size()));
+	const std::size_t errors = context.diagnostics.size();
+	REQUIRE(errors > 0);
+
+	BENCHMARK("Recovering parse of valid input")
+	{
+		return parse(context, valid.data(), valid.data() + valid.size());
+	};
+
+	BENCHMARK("Recovering parse with " + std::to_string(errors) + " errors")
+	{
+		return parse(context, broken.data(), broken.data() + broken.size());
+	};
+}
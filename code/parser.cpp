@@ -1,85 +1,309 @@
 #include "parser.h"
-#include "token_iterator.h"
-#include "filter_iterator.h"
-#include "symbol.h"
+#include "thread_pool.h"
 
-#include <string_view>
+#include <algorithm>
+#include <array>
+#include <atomic>
 
-struct Not_whitespace_or_comment
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+auto Parse_events::on_procedure_begin(const Token_buffer&, std::uint32_t) -> void
+{
+}
+
+auto Parse_events::on_procedure_end(const Token_buffer&, std::uint32_t, std::uint32_t) -> void
+{
+}
+
+auto Parse_events::on_struct(const Token_buffer&, std::uint32_t) -> void
+{
+}
+
+auto Parse_events::on_template_decl(const Token_buffer&, std::uint32_t) -> void
+{
+}
+
+auto Parse_events::on_expression_end(const Token_buffer&, std::uint32_t, std::uint32_t) -> void
+{
+}
+
+auto input(const Parser_context& context) -> const Token_buffer&
 {
-	auto operator()(const Token& x) const -> bool
+	return context.outer ? context.outer->tokens : context.tokens;
+}
+
+auto at_end(Parser_context& context) -> bool
+{
+	return context.position == input(context).size();
+}
+
+auto current_atom(Parser_context& context) -> Atom
+{
+	return input(context).atom(context.position);
+}
+
+auto emit(Parser_context& context, Node_kind kind, std::uint32_t token, std::uint32_t first) -> void
+{
+	if (!context.events)
 	{
-		switch (x.kind)
-		{
-		case Token_kind::comment:
-		case Token_kind::newline:
-		case Token_kind::tab:
-		case Token_kind::space: {
-			return false;
-		} break;
+		context.ast.push_back(Node{kind, token, first});
+	}
+}
 
-		default: {
-			return true;
-		} break;
+auto lookup(Parser_context& context, Atom name) -> const Symbol*
+{
+	const Symbol* symbol = context.symbols.get(name);
+	if (!symbol && context.outer)
+	{
+		symbol = context.outer->symbols.get(name, context.watermark);
+	}
+	return symbol;
+}
+
+/*
+ * Parses rule at the current position, or in a memoizing context replays
+ * its outcome there if the symbols it looks up have not changed since.
+ * Pushes only ever count up and a pop only removes bindings, so the symbol
+ * table is unchanged while both counts are.
+ */
+auto parse_memoized(Parser_context& context, Rule rule, auto (*parse)(Parser_context&) -> bool) -> bool
+{
+	if (!context.memoize)
+	{
+		return parse(context);
+	}
+
+	const std::uint32_t start = context.position;
+	const std::uint32_t first = context.ast.size();
+	const std::uint64_t state = std::uint64_t(context.symbols.pushes()) << 32 | context.symbols.bindings();
+	if (const Memo_entry* entry = context.memo.find(rule, start))
+	{
+		if (entry->state == state)
+		{
+			context.memo.replay(*entry, context.ast);
+			context.position = entry->end;
+			return entry->parsed;
 		}
 	}
-};
 
-using Iterator = Filter_iterator<Token_iterator, Not_whitespace_or_comment>;
+	const bool parsed = parse(context);
+	context.memo.insert(rule, start, parsed, context.position, state, context.ast, first);
+	return parsed;
+}
+
+// An address in the current frame on the thread's own stack, where the
+// address of a local may be elsewhere under a sanitizer's fake stack.
+auto stack_address() -> std::uintptr_t
+{
+#if defined(_MSC_VER)
+	return reinterpret_cast<std::uintptr_t>(_AddressOfReturnAddress());
+#else
+	return reinterpret_cast<std::uintptr_t>(__builtin_frame_address(0));
+#endif
+}
+
+auto limit_stack(Parser_context& context) -> void
+{
+	context.stack_limit = stack_address() - context.stack_budget;
+}
+
+auto stack_exhausted(const Parser_context& context) -> bool
+{
+	return stack_address() < context.stack_limit;
+}
+
+auto parse_nested(Parser_context& context, Nested rule, unsigned power = 0) -> bool;
 
-static Iterator s_token_iter;
-static Iterator s_token_end;
+auto advance(Parser_context& context) -> void
+{
+	++context.position;
+	++context.visited;
+}
 
-auto peek(Token_kind kind) -> bool
+auto peek(Parser_context& context, Token_kind kind) -> bool
 {
-	return s_token_iter != s_token_end && s_token_iter->kind == kind;
+	return !at_end(context) && input(context).kind(context.position) == kind;
 }
 
-auto peek(std::string_view keyword) -> bool
+/*
+ * Where the grammar expects a name, keywords are accepted as well; only
+ * primary expressions treat a keyword differently from an identifier.
+ */
+auto peek_name(Parser_context& context) -> bool
 {
-	if (!peek(Token_kind::identifier))
+	if (at_end(context))
 	{
 		return false;
 	}
 
-	return std::equal(s_token_iter->begin, s_token_iter->end, keyword.begin(), keyword.end());
+	const Token_kind kind = input(context).kind(context.position);
+	return kind == Token_kind::identifier || is_keyword(kind);
+}
+
+auto peek_name(Parser_context& context, Atom name) -> bool
+{
+	return peek_name(context) && current_atom(context) == name;
+}
+
+auto match(Parser_context& context, Token_kind kind) -> bool
+{
+	if (peek(context, kind))
+	{
+		advance(context);
+		return true;
+	}
+	return false;
 }
 
-auto match(Token_kind kind) -> bool
+auto match_name(Parser_context& context) -> bool
 {
-	if (peek(kind))
+	if (peek_name(context))
 	{
-		++s_token_iter;
+		advance(context);
 		return true;
 	}
 	return false;
 }
 
-auto match(std::string_view keyword) -> bool
+auto match_name(Parser_context& context, Atom name) -> bool
 {
-	if (peek(keyword))
+	if (peek_name(context, name))
 	{
-		++s_token_iter;
+		advance(context);
 		return true;
 	}
 	return false;
 }
 
-auto parse_expression() -> bool;
+// Notes how far a construct got before failing, for the diagnostic of a recovering parse.
+auto note_failure(Parser_context& context) -> void
+{
+	context.stopped = std::max(context.stopped, context.position);
+}
+
+/*
+ * Panic-mode recovery once the construct at start has failed: reports it
+ * and skips to where the next one can begin, counting braces from start
+ * but stopping no earlier than where the parse stopped.  A nested construct
+ * also ends before a "}" that closes the enclosing block, and a declaration
+ * before a keyword that begins one.  The construct's scopes are closed and
+ * its nodes replaced by an error node.  Returns false if the input ends
+ * first, leaving the enclosing constructs cut off without more diagnostics.
+ */
+auto recover(Parser_context& context, Construct construct, std::uint32_t start, std::uint32_t first, std::size_t depth) -> bool
+{
+	const Token_buffer& tokens = input(context);
+	const std::uint32_t size = tokens.size();
+	const std::uint32_t stopped = std::max(context.stopped, context.position);
+
+	while (context.symbols.depth() > depth)
+	{
+		context.symbols.pop_scope();
+	}
+	context.ast.truncate(first);
+
+	if (!context.diagnostics.empty() && context.diagnostics.back().cut_off)
+	{
+		context.position = size;
+		return false;
+	}
+
+	if (context.diagnostics.empty())
+	{
+		context.passes = context.position == size && context.resetting == 0;
+	}
+
+	const bool nested = construct != Construct::declaration;
+	std::uint32_t braces = 0;
+	std::uint32_t end = size;
+	bool found = false;
+	std::uint32_t i = start;
+	for (; i < size && !found; ++i)
+	{
+		switch (tokens.kind(i))
+		{
+		case Token_kind::open_brace: {
+			++braces;
+		} break;
+
+		case Token_kind::close_brace: {
+			if (braces == 0)
+			{
+				// Closes the enclosing block, or at top level is a stray brace to skip.
+				found = nested || i >= stopped;
+				end = nested ? i : i + 1;
+			}
+			else if (--braces == 0 && i >= stopped)
+			{
+				found = true;
+				end = i + 1 < size && tokens.kind(i + 1) == Token_kind::semicolon ? i + 2 : i + 1;
+			}
+		} break;
+
+		case Token_kind::semicolon: {
+			if (braces == 0 && i >= stopped)
+			{
+				found = true;
+				end = i + 1;
+			}
+		} break;
+
+		case Token_kind::keyword_struct:
+		case Token_kind::keyword_enum:
+		case Token_kind::keyword_template: {
+			if (!nested && braces == 0 && i > start && i >= stopped)
+			{
+				found = true;
+				end = i;
+			}
+		} break;
+
+		default: {
+		} break;
+		}
+	}
+
+	context.visited += i - start;
+
+	if (!found)
+	{
+		end = size;
+	}
+	context.diagnostics.push_back(Diagnostic{construct, stopped, start, end, !found});
+	if (start != size)
+	{
+		emit(context, Node_kind::error, start, first);
+	}
+	context.position = end;
+	return found;
+}
+
+auto parse_expression(Parser_context& context) -> bool;
+
+auto parse_additive(Parser_context& context) -> bool;
+auto parse_binary(Parser_context& context, unsigned power) -> bool;
 
-auto parse_additive() -> bool;
+static constexpr unsigned s_additive_power = 5;
 
 /*
  * additive_list	= additive {"," additive}.
  */
-auto parse_additive_list() -> bool
+auto parse_additive_list(Parser_context& context) -> bool
 {
+	if (stack_exhausted(context))
+	{
+		return parse_nested(context, Nested::additive_list);
+	}
+
 	do {
-		if (!parse_additive())
+		const bool parsed = context.expressions == Expressions::climbing ? parse_binary(context, s_additive_power) : parse_additive(context);
+		if (!parsed)
 		{
 			return false;
 		}
-	} while (match(Token_kind::comma));
+	} while (match(context, Token_kind::comma));
 
 	return true;
 }
@@ -87,62 +311,76 @@ auto parse_additive_list() -> bool
 /*
  * primary		= literal | identifier | "(" expression ")" | basic_type | template_name | "typename".
  */
-auto parse_primary() -> bool
+auto parse_primary(Parser_context& context) -> bool
 {
+	const std::uint32_t token = context.position;
+	const std::uint32_t first = context.ast.size();
+
+	context.stack_low = std::min(context.stack_low, stack_address());
+
 	// template_name = (structure_name | procedure_name) ["<" additive_list ">"].
-	if (peek(Token_kind::identifier))
+	if (peek(context, Token_kind::identifier))
 	{
-		const Symbol* symbol = symbol_get(s_token_iter->begin, s_token_iter->end);
+		const Symbol* symbol = lookup(context, current_atom(context));
 		if (symbol && (symbol->kind == Symbol_kind::type || symbol->kind == Symbol_kind::procedure))
 		{
-			++s_token_iter;
-			if (match(Token_kind::less))
+			advance(context);
+			if (match(context, Token_kind::less))
 			{
-				if (!parse_additive_list())
+				if (!parse_additive_list(context))
 				{
 					return false;
 				}
 
-				if (!match(Token_kind::greater))
+				if (!match(context, Token_kind::greater))
 				{
 					return false;
 				}
+
+				emit(context, Node_kind::template_instance, token, first);
+				return true;
 			}
+
+			emit(context, Node_kind::name, token, first);
 			return true;
 		}
 	}
 
 	// literal = boolean | integer | real.
-	if (match("true") || match("false") || match(Token_kind::integer) || match(Token_kind::real))
+	if (match(context, Token_kind::keyword_true) || match(context, Token_kind::keyword_false) || match(context, Token_kind::integer) || match(context, Token_kind::real))
 	{
+		emit(context, Node_kind::literal, token, first);
 		return true;
 	}
 
 	// "(" expression ")"
-	if (match(Token_kind::open_paren))
+	if (match(context, Token_kind::open_paren))
 	{
-		if (!parse_expression())
+		if (!parse_expression(context))
 		{
 			return false;
 		}
 
-		return match(Token_kind::close_paren);
+		return match(context, Token_kind::close_paren);
 	}
 
 	// basic_type = "bool" | "int" | "double".
-	if (match("bool") || match("int") || match("double"))
+	if (match(context, Token_kind::keyword_bool) || match(context, Token_kind::keyword_int) || match(context, Token_kind::keyword_double))
 	{
+		emit(context, Node_kind::basic_type, token, first);
 		return true;
 	}
 
 	// "typename"
-	if (match("typename"))
+	if (match(context, Token_kind::keyword_typename))
 	{
+		emit(context, Node_kind::basic_type, token, first);
 		return true;
 	}
 
-	if (match(Token_kind::identifier))
+	if (match(context, Token_kind::identifier))
 	{
+		emit(context, Node_kind::name, token, first);
 		return true;
 	}
 
@@ -155,53 +393,59 @@ auto parse_primary() -> bool
  * 				| "[" expression "]"
  * 				| "&"}.
  */
-auto parse_postfix() -> bool
+auto parse_postfix(Parser_context& context) -> bool
 {
-	if (!parse_primary())
+	const std::uint32_t first = context.ast.size();
+	if (!parse_primary(context))
 	{
 		return false;
 	}
 
 	while (true)
 	{
-		if (match(Token_kind::dot))
+		const std::uint32_t token = context.position;
+		if (match(context, Token_kind::dot))
 		{
-			if (!match(Token_kind::identifier))
+			if (!match_name(context))
 			{
 				return false;
 			}
+			emit(context, Node_kind::member, token + 1, first);
 		}
-		else if (match(Token_kind::open_paren))
+		else if (match(context, Token_kind::open_paren))
 		{
-			if (!peek(Token_kind::close_paren))
+			if (!peek(context, Token_kind::close_paren))
 			{
 				do {
-					if (!parse_expression())
+					if (!parse_expression(context))
 					{
 						return false;
 					}
-				} while (match(Token_kind::comma));
+				} while (match(context, Token_kind::comma));
 			}
 
-			if (!match(Token_kind::close_paren))
+			if (!match(context, Token_kind::close_paren))
 			{
 				return false;
 			}
+			emit(context, Node_kind::call, token, first);
 		}
-		else if (match(Token_kind::open_bracket))
+		else if (match(context, Token_kind::open_bracket))
 		{
-			if (!parse_expression())
+			if (!parse_expression(context))
 			{
 				return false;
 			}
 
-			if (!match(Token_kind::close_bracket))
+			if (!match(context, Token_kind::close_bracket))
 			{
 				return false;
 			}
+			emit(context, Node_kind::subscript, token, first);
 		}
-		else if (match(Token_kind::ampersand))
+		else if (match(context, Token_kind::ampersand))
 		{
+			emit(context, Node_kind::address, token, first);
 		}
 		else
 		{
@@ -215,33 +459,37 @@ auto parse_postfix() -> bool
 /*
  * prefix		= ["-" | "!" | "const"] postfix.
  */
-auto parse_prefix() -> bool
+auto parse_prefix(Parser_context& context) -> bool
 {
-	if (match(Token_kind::minus))
-	{
-	}
-	else if (match(Token_kind::bang))
+	const std::uint32_t token = context.position;
+	const std::uint32_t first = context.ast.size();
+	const bool unary = match(context, Token_kind::minus) || match(context, Token_kind::bang) || match(context, Token_kind::keyword_const);
+
+	if (!parse_postfix(context))
 	{
+		return false;
 	}
-	else if (match("const"))
+
+	if (unary)
 	{
+		emit(context, Node_kind::prefix, token, first);
 	}
-	return parse_postfix();
+	return true;
 }
 
-auto match_multiplicative() -> bool
+auto match_multiplicative(Parser_context& context) -> bool
 {
-	if (s_token_iter == s_token_end)
+	if (at_end(context))
 	{
 		return false;
 	}
 
-	switch (s_token_iter->kind)
+	switch (input(context).kind(context.position))
 	{
 	case Token_kind::star:
 	case Token_kind::forward_slash:
 	case Token_kind::percent: {
-		++s_token_iter;
+		advance(context);
 		return true;
 	} break;
 
@@ -254,36 +502,39 @@ auto match_multiplicative() -> bool
 /*
  * multiplicative	= prefix {("*" | "/" | "%") prefix}.
  */
-auto parse_multiplicative() -> bool
+auto parse_multiplicative(Parser_context& context) -> bool
 {
-	if (!parse_prefix())
+	const std::uint32_t first = context.ast.size();
+	if (!parse_prefix(context))
 	{
 		return false;
 	}
 
-	while (match_multiplicative())
+	while (match_multiplicative(context))
 	{
-		if (!parse_prefix())
+		const std::uint32_t token = context.position - 1;
+		if (!parse_prefix(context))
 		{
 			return false;
 		}
+		emit(context, Node_kind::binary, token, first);
 	}
 
 	return true;
 }
 
-auto match_additive() -> bool
+auto match_additive(Parser_context& context) -> bool
 {
-	if (s_token_iter == s_token_end)
+	if (at_end(context))
 	{
 		return false;
 	}
 
-	switch (s_token_iter->kind)
+	switch (input(context).kind(context.position))
 	{
 	case Token_kind::plus:
 	case Token_kind::minus: {
-		++s_token_iter;
+		advance(context);
 		return true;
 	} break;
 
@@ -296,38 +547,41 @@ auto match_additive() -> bool
 /*
  * additive		= multiplicative {("+" | "-") multiplicative}.
  */
-auto parse_additive() -> bool
+auto parse_additive(Parser_context& context) -> bool
 {
-	if (!parse_multiplicative())
+	const std::uint32_t first = context.ast.size();
+	if (!parse_multiplicative(context))
 	{
 		return false;
 	}
 
-	while (match_additive())
+	while (match_additive(context))
 	{
-		if (!parse_multiplicative())
+		const std::uint32_t token = context.position - 1;
+		if (!parse_multiplicative(context))
 		{
 			return false;
 		}
+		emit(context, Node_kind::binary, token, first);
 	}
 
 	return true;
 }
 
-auto match_relational() -> bool
+auto match_relational(Parser_context& context) -> bool
 {
-	if (s_token_iter == s_token_end)
+	if (at_end(context))
 	{
 		return false;
 	}
 
-	switch (s_token_iter->kind)
+	switch (input(context).kind(context.position))
 	{
 	case Token_kind::less:
 	case Token_kind::greater:
 	case Token_kind::less_equals:
 	case Token_kind::greater_equals: {
-		++s_token_iter;
+		advance(context);
 		return true;
 	} break;
 
@@ -340,36 +594,39 @@ auto match_relational() -> bool
 /*
  * relational		= additive {("<" | ">" | "<=" | ">=") additive}.
  */
-auto parse_relational() -> bool
+auto parse_relational(Parser_context& context) -> bool
 {
-	if (!parse_additive())
+	const std::uint32_t first = context.ast.size();
+	if (!parse_additive(context))
 	{
 		return false;
 	}
 
-	while (match_relational())
+	while (match_relational(context))
 	{
-		if (!parse_additive())
+		const std::uint32_t token = context.position - 1;
+		if (!parse_additive(context))
 		{
 			return false;
 		}
+		emit(context, Node_kind::binary, token, first);
 	}
 
 	return true;
 }
 
-auto match_equality() -> bool
+auto match_equality(Parser_context& context) -> bool
 {
-	if (s_token_iter == s_token_end)
+	if (at_end(context))
 	{
 		return false;
 	}
 
-	switch (s_token_iter->kind)
+	switch (input(context).kind(context.position))
 	{
 	case Token_kind::double_equals:
 	case Token_kind::bang_equals: {
-		++s_token_iter;
+		advance(context);
 		return true;
 	} break;
 
@@ -382,19 +639,22 @@ auto match_equality() -> bool
 /*
  * equality		= relational {("==" | "!=") relational}.
  */
-auto parse_equality() -> bool
+auto parse_equality(Parser_context& context) -> bool
 {
-	if (!parse_relational())
+	const std::uint32_t first = context.ast.size();
+	if (!parse_relational(context))
 	{
 		return false;
 	}
 
-	while (match_equality())
+	while (match_equality(context))
 	{
-		if (!parse_relational())
+		const std::uint32_t token = context.position - 1;
+		if (!parse_relational(context))
 		{
 			return false;
 		}
+		emit(context, Node_kind::binary, token, first);
 	}
 
 	return true;
@@ -403,19 +663,22 @@ auto parse_equality() -> bool
 /*
  * conjunction		= equality {"&&" equality}.
  */
-auto parse_conjunction() -> bool
+auto parse_conjunction(Parser_context& context) -> bool
 {
-	if (!parse_equality())
+	const std::uint32_t first = context.ast.size();
+	if (!parse_equality(context))
 	{
 		return false;
 	}
 
-	while (match(Token_kind::double_ampersand))
+	while (match(context, Token_kind::double_ampersand))
 	{
-		if (!parse_expression())
+		const std::uint32_t token = context.position - 1;
+		if (!parse_expression(context))
 		{
 			return false;
 		}
+		emit(context, Node_kind::binary, token, first);
 	}
 
 	return true;
@@ -424,19 +687,83 @@ auto parse_conjunction() -> bool
 /*
  * disjunction		= conjunction {"||" conjunction}.
  */
-auto parse_disjunction() -> bool
+auto parse_disjunction(Parser_context& context) -> bool
+{
+	const std::uint32_t first = context.ast.size();
+	if (!parse_conjunction(context))
+	{
+		return false;
+	}
+
+	while (match(context, Token_kind::double_pipe))
+	{
+		const std::uint32_t token = context.position - 1;
+		if (!parse_conjunction(context))
+		{
+			return false;
+		}
+		emit(context, Node_kind::binary, token, first);
+	}
+
+	return true;
+}
+
+// Binding powers of the binary operators, loosest first; zero for every other token.
+static constexpr auto s_binding_powers = []
+{
+	std::array<std::uint8_t, 256> powers{};
+	powers[static_cast<std::uint8_t>(Token_kind::double_pipe)] = 1;
+	powers[static_cast<std::uint8_t>(Token_kind::double_ampersand)] = 2;
+	powers[static_cast<std::uint8_t>(Token_kind::double_equals)] = 3;
+	powers[static_cast<std::uint8_t>(Token_kind::bang_equals)] = 3;
+	powers[static_cast<std::uint8_t>(Token_kind::less)] = 4;
+	powers[static_cast<std::uint8_t>(Token_kind::greater)] = 4;
+	powers[static_cast<std::uint8_t>(Token_kind::less_equals)] = 4;
+	powers[static_cast<std::uint8_t>(Token_kind::greater_equals)] = 4;
+	powers[static_cast<std::uint8_t>(Token_kind::plus)] = s_additive_power;
+	powers[static_cast<std::uint8_t>(Token_kind::minus)] = s_additive_power;
+	powers[static_cast<std::uint8_t>(Token_kind::star)] = 6;
+	powers[static_cast<std::uint8_t>(Token_kind::forward_slash)] = 6;
+	powers[static_cast<std::uint8_t>(Token_kind::percent)] = 6;
+	return powers;
+}();
+
+/*
+ * Precedence climbing over the levels from disjunction to multiplicative:
+ * parses a prefix expression followed by any operators binding at least as
+ * tightly as power, recursing once per operator rather than once per level.
+ * Operators are left associative except "&&", whose right operand is a whole
+ * expression as in parse_conjunction.
+ */
+auto parse_binary(Parser_context& context, unsigned power) -> bool
 {
-	if (!parse_conjunction())
+	if (stack_exhausted(context))
+	{
+		return parse_nested(context, Nested::binary, power);
+	}
+
+	const std::uint32_t first = context.ast.size();
+	if (!parse_prefix(context))
 	{
 		return false;
 	}
 
-	while (match(Token_kind::double_pipe))
+	while (!at_end(context))
 	{
-		if (!parse_conjunction())
+		const std::uint32_t token = context.position;
+		const Token_kind kind = input(context).kind(token);
+		const unsigned left = s_binding_powers[static_cast<std::uint8_t>(kind)];
+		if (left == 0 || left < power)
+		{
+			break;
+		}
+
+		advance(context);
+		if (!parse_binary(context, kind == Token_kind::double_ampersand ? 1 : left + 1))
 		{
 			return false;
 		}
+		emit(context, Node_kind::binary, token, first);
 	}
 
 	return true;
@@ -445,67 +772,93 @@ auto parse_disjunction() -> bool
 /*
  * expression		= disjunction.
  */
-auto parse_expression() -> bool
+auto parse_expression(Parser_context& context) -> bool
 {
-	return parse_disjunction();
+	if (stack_exhausted(context))
+	{
+		return parse_nested(context, Nested::expression);
+	}
+
+	const std::uint32_t start = context.position;
+	const bool parsed = context.expressions == Expressions::climbing ? parse_binary(context, 1) : parse_disjunction(context);
+	if (parsed && context.events)
+	{
+		context.events->on_expression_end(input(context), start, context.position);
+	}
+	return parsed;
 }
 
 /*
  * enumeration		= "enum" identifier "{" identifier_list "}" ";".
  */
-auto parse_enumeration() -> bool
+auto parse_enumeration(Parser_context& context) -> bool
 {
-	if (!match("enum"))
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_enum))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::identifier))
+	const std::uint32_t name = context.position;
+	if (!match_name(context))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_brace))
+	if (!match(context, Token_kind::open_brace))
 	{
 		return false;
 	}
 
-	if (!peek(Token_kind::close_brace))
+	if (!peek(context, Token_kind::close_brace))
 	{
 		do
 		{
-			if (!match(Token_kind::identifier))
+			const std::uint32_t enumerator = context.position;
+			if (!match_name(context))
 			{
 				return false;
 			}
+			emit(context, Node_kind::enumerator, enumerator, context.ast.size());
 		}
-		while (match(Token_kind::comma));
+		while (match(context, Token_kind::comma));
 	}
 
-	if (!match(Token_kind::close_brace))
+	if (!match(context, Token_kind::close_brace))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::semicolon))
+	if (!match(context, Token_kind::semicolon))
 	{
 		return false;
 	}
 
+	emit(context, Node_kind::enumeration, name, first);
 	return true;
 }
 
 /*
  * parameter		= expression [identifier].
  */
-auto parse_parameter() -> bool
+auto parse_parameter(Parser_context& context) -> bool
 {
-	if (!parse_expression())
+	const std::uint32_t start = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!parse_expression(context))
 	{
 		return false;
 	}
 
-	match(Token_kind::identifier);
+	const std::uint32_t name = context.position;
+	if (match_name(context))
+	{
+		emit(context, Node_kind::parameter, name, first);
+	}
+	else
+	{
+		emit(context, Node_kind::unnamed_parameter, start, first);
+	}
 
 	return true;
 }
@@ -513,451 +866,509 @@ auto parse_parameter() -> bool
 /*
  * parameter_list	= parameter {"," parameter}.
  */
-auto parse_parameter_list() -> bool
+auto parse_parameter_list(Parser_context& context) -> bool
 {
 	do {
-		if (!parse_parameter())
+		if (!parse_parameter(context))
 		{
 			return false;
 		}
-	} while (match(Token_kind::comma));
+	} while (match(context, Token_kind::comma));
 	return true;
 }
 
 /*
  * structure_name	= identifier.
  */
-auto parse_structure_name() -> const Symbol*
+auto parse_structure_name(Parser_context& context) -> const Symbol*
 {
-	if (!peek(Token_kind::identifier))
+	if (!peek_name(context))
 	{
 		return nullptr;
 	}
 
-	const Symbol* symbol = symbol_push(s_token_iter->begin, s_token_iter->end, Symbol_kind::type);
-	++s_token_iter;
+	const Symbol* symbol = context.symbols.push(current_atom(context), Symbol_kind::type);
+	advance(context);
 	return symbol;
 }
 
 /*
  * expression_list	= expression {"," expression }.
  */
-auto parse_expression_list() -> bool
+auto parse_expression_list(Parser_context& context) -> bool
 {
 	do {
-		if (!parse_expression())
+		if (!parse_expression(context))
 		{
 			return false;
 		}
-	} while (match(Token_kind::comma));
+	} while (match(context, Token_kind::comma));
 	return true;
 }
 
 /*
  * initializer		= identifier "(" [expression_list] ")".
  */
-auto parse_initializer() -> bool
+auto parse_initializer(Parser_context& context) -> bool
 {
-	if (!match(Token_kind::identifier))
+	const std::uint32_t name = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!match_name(context))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_paren))
+	if (!match(context, Token_kind::open_paren))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::close_paren))
+	if (!match(context, Token_kind::close_paren))
 	{
-		if (!parse_expression_list())
+		if (!parse_expression_list(context))
 		{
 			return false;
 		}
 
-		if (!match(Token_kind::close_paren))
+		if (!match(context, Token_kind::close_paren))
 		{
 			return false;
 		}
 	}
 
+	emit(context, Node_kind::initializer, name, first);
 	return true;
 }
 
 /*
  * initializer_list	= initializer {"," initializer}.
  */
-auto parse_initializer_list() -> bool
+auto parse_initializer_list(Parser_context& context) -> bool
 {
 	do {
-		if (!parse_initializer())
+		if (!parse_initializer(context))
 		{
 			return false;
 		}
-	} while (match(Token_kind::comma));
+	} while (match(context, Token_kind::comma));
 	return true;
 }
 
-auto parse_statement() -> bool;
+auto parse_statement(Parser_context& context) -> bool;
 
 /*
  * initialization	= "(" expression_list ")" | "=" expression.
  */
-auto parse_initialization() -> bool
+auto parse_initialization(Parser_context& context) -> bool
 {
-	if (match(Token_kind::open_paren))
+	if (match(context, Token_kind::open_paren))
 	{
-		if (!parse_expression_list())
+		if (!parse_expression_list(context))
 		{
 			return false;
 		}
 
-		if (!match(Token_kind::close_paren))
-		{
-			return false;
-		}
+		return match(context, Token_kind::close_paren);
 	}
-	else if (match(Token_kind::equals))
+
+	if (match(context, Token_kind::equals))
 	{
-		if (!parse_expression())
-		{
-			return false;
-		}
+		return parse_expression(context);
 	}
 
 	return false;
 }
 
 /*
+ * simple_statement	= expression ";".
+ * assignment		= expression "=" expression ";".
  * construction		= expression identifier [initialization] ";".
+ *
+ * All three begin with an expression, so it is parsed once and the token
+ * after it chooses the statement.
  */
-auto parse_construction() -> bool
+auto parse_expression_statement(Parser_context& context) -> bool
 {
-	if (!parse_expression())
+	const std::uint32_t start = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!parse_expression(context))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::identifier))
+	const std::uint32_t token = context.position;
+	if (match(context, Token_kind::semicolon))
 	{
-		return false;
+		emit(context, Node_kind::expression_statement, start, first);
+		return true;
 	}
 
-	if (!peek(Token_kind::semicolon))
+	if (match(context, Token_kind::equals))
 	{
-		if (!parse_initialization())
+		if (!parse_expression(context))
 		{
 			return false;
 		}
-	}
 
-	return match(Token_kind::semicolon);
-}
+		if (!match(context, Token_kind::semicolon))
+		{
+			return false;
+		}
 
-/*
- * assignment		= expression "=" expression ";".
- */
-auto parse_assignment() -> bool
-{
-	if (!parse_expression())
-	{
-		return false;
+		emit(context, Node_kind::assignment, token, first);
+		return true;
 	}
 
-	if (!match(Token_kind::equals))
+	if (!match_name(context))
 	{
 		return false;
 	}
 
-	if (!parse_expression())
+	if (!peek(context, Token_kind::semicolon))
 	{
-		return false;
+		if (!parse_initialization(context))
+		{
+			return false;
+		}
 	}
 
-	return match(Token_kind::semicolon);
-}
-
-/*
- * simple_statement	= expression ";".
- */
-auto parse_simple_statement() -> bool
-{
-	if (!parse_expression())
+	if (!match(context, Token_kind::semicolon))
 	{
 		return false;
 	}
 
-	return match(Token_kind::semicolon);
+	emit(context, Node_kind::construction, token, first);
+	return true;
 }
 
 /*
  * return		= "return" [expression] ";".
  */
-auto parse_return() -> bool
+auto parse_return(Parser_context& context) -> bool
 {
-	if (!match("return"))
+	const std::uint32_t token = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_return))
 	{
 		return false;
 	}
 
-	if (!peek(Token_kind::semicolon))
+	if (!peek(context, Token_kind::semicolon))
 	{
-		if (!parse_expression())
+		if (!parse_expression(context))
 		{
 			return false;
 		}
 	}
 
-	return match(Token_kind::semicolon);
+	if (!match(context, Token_kind::semicolon))
+	{
+		return false;
+	}
+
+	emit(context, Node_kind::return_statement, token, first);
+	return true;
 }
 
 /*
  * conditional		= "if" "(" expression ")" statement ["else" statement].
  */
-auto parse_conditional() -> bool
+auto parse_conditional(Parser_context& context) -> bool
 {
-	if (!match("if"))
+	const std::uint32_t token = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_if))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_paren))
+	if (!match(context, Token_kind::open_paren))
 	{
 		return false;
 	}
 
-	if (!parse_expression())
+	if (!parse_expression(context))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::close_paren))
+	if (!match(context, Token_kind::close_paren))
 	{
 		return false;
 	}
 
-	if (!parse_statement())
+	if (!parse_statement(context))
 	{
 		return false;
 	}
 
-	if (match("else"))
+	if (match(context, Token_kind::keyword_else))
 	{
-		if (!parse_statement())
+		if (!parse_statement(context))
 		{
 			return false;
 		}
 	}
 
+	emit(context, Node_kind::conditional, token, first);
 	return true;
 }
 
-auto parse_case() -> bool;
+auto parse_case(Parser_context& context) -> bool;
 
 /*
  * switch		= "switch" "(" expression ")" "{" {case} "}".
  */
-auto parse_switch() -> bool
+auto parse_switch(Parser_context& context) -> bool
 {
-	if (!match("switch"))
+	const std::uint32_t token = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_switch))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_paren))
+	if (!match(context, Token_kind::open_paren))
 	{
 		return false;
 	}
 
-	if (!parse_expression())
+	if (!parse_expression(context))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::close_paren))
+	if (!match(context, Token_kind::close_paren))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_brace))
+	if (!match(context, Token_kind::open_brace))
 	{
 		return false;
 	}
 
-	while (peek("case"))
+	while (peek(context, Token_kind::keyword_case))
 	{
-		if (!parse_case())
+		if (!parse_case(context))
 		{
 			return false;
 		}
 	}
 
-	return match(Token_kind::close_brace);
+	if (!match(context, Token_kind::close_brace))
+	{
+		return false;
+	}
+
+	emit(context, Node_kind::switch_statement, token, first);
+	return true;
 }
 
 /*
  * case			= "case" expression ":" {statement}.
  */
-auto parse_case() -> bool
+auto parse_case(Parser_context& context) -> bool
 {
-	if (!match("case"))
+	const std::uint32_t token = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_case))
 	{
 		return false;
 	}
 
-	while (!peek(Token_kind::close_brace) && !peek("break"))
+	while (!peek(context, Token_kind::close_brace) && !peek(context, Token_kind::keyword_break))
 	{
-		if (!parse_statement())
+		const std::uint32_t start = context.position;
+		const std::uint32_t nodes = context.ast.size();
+		const std::size_t depth = context.symbols.depth();
+		if (!parse_statement(context))
 		{
-			return false;
+			if (!context.recover || !recover(context, Construct::statement, start, nodes, depth))
+			{
+				return false;
+			}
 		}
 	}
 
+	emit(context, Node_kind::case_clause, token, first);
 	return true;
 }
 
 /*
  * while		= "while" "(" expression ")" statement.
  */
-auto parse_while() -> bool
+auto parse_while(Parser_context& context) -> bool
 {
-	if (!match("while"))
+	const std::uint32_t token = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_while))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_paren))
+	if (!match(context, Token_kind::open_paren))
 	{
 		return false;
 	}
 
-	if (!parse_expression())
+	if (!parse_expression(context))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::close_paren))
+	if (!match(context, Token_kind::close_paren))
 	{
 		return false;
 	}
 
-	return parse_statement();
+	if (!parse_statement(context))
+	{
+		return false;
+	}
+
+	emit(context, Node_kind::while_statement, token, first);
+	return true;
 }
 
 /*
  * do			= "do" statement "while" "(" expression ")" ";".
  */
-auto parse_do() -> bool
+auto parse_do(Parser_context& context) -> bool
 {
-	if (!match("do"))
+	const std::uint32_t token = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_do))
+	{
+		return false;
+	}
+
+	if (!parse_statement(context))
 	{
 		return false;
 	}
 
-	if (!parse_statement())
+	if (!match(context, Token_kind::keyword_while))
 	{
 		return false;
 	}
 
-	if (!match("while"))
+	if (!match(context, Token_kind::open_paren))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_paren))
+	if (!parse_expression(context))
 	{
 		return false;
 	}
 
-	if (!parse_expression())
+	if (!match(context, Token_kind::close_paren))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::close_paren))
+	if (!match(context, Token_kind::semicolon))
 	{
 		return false;
 	}
 
-	return match(Token_kind::semicolon);
+	emit(context, Node_kind::do_statement, token, first);
+	return true;
 }
 
 /*
  * break		= "break" ";".
  */
-auto parse_break() -> bool
+auto parse_break(Parser_context& context) -> bool
 {
-	if (!match("break"))
+	const std::uint32_t token = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_break))
+	{
+		return false;
+	}
+
+	if (!match(context, Token_kind::semicolon))
 	{
 		return false;
 	}
 
-	return match(Token_kind::semicolon);
+	emit(context, Node_kind::break_statement, token, first);
+	return true;
 }
 
 /*
  * goto			= "goto" identifier ";".
  */
-auto parse_goto() -> bool
+auto parse_goto(Parser_context& context) -> bool
 {
-	if (!match("goto"))
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_goto))
+	{
+		return false;
+	}
+
+	const std::uint32_t name = context.position;
+	if (!match_name(context))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::identifier))
+	if (!match(context, Token_kind::semicolon))
 	{
 		return false;
 	}
 
-	return match(Token_kind::semicolon);
+	emit(context, Node_kind::goto_statement, name, first);
+	return true;
 }
 
-auto parse_compound() -> bool;
+auto parse_compound(Parser_context& context) -> bool;
 
 /*
  * control_statement	= return | conditional | switch | while | do | compound | break | goto.
  */
-auto parse_control_statement() -> bool
+auto parse_control_statement(Parser_context& context) -> bool
 {
-	if (peek("return"))
+	if (peek(context, Token_kind::keyword_return))
 	{
-		return parse_return();
+		return parse_return(context);
 	}
 
-	if (peek("if"))
+	if (peek(context, Token_kind::keyword_if))
 	{
-		return parse_conditional();
+		return parse_conditional(context);
 	}
 
-	if (peek("switch"))
+	if (peek(context, Token_kind::keyword_switch))
 	{
-		return parse_switch();
+		return parse_switch(context);
 	}
 
-	if (peek("while"))
+	if (peek(context, Token_kind::keyword_while))
 	{
-		return parse_while();
+		return parse_while(context);
 	}
 
-	if (peek("do"))
+	if (peek(context, Token_kind::keyword_do))
 	{
-		return parse_do();
+		return parse_do(context);
 	}
 
-	if (peek(Token_kind::open_brace))
+	if (peek(context, Token_kind::open_brace))
 	{
-		return parse_compound();
+		return parse_compound(context);
 	}
 
-	if (peek("break"))
+	if (peek(context, Token_kind::keyword_break))
 	{
-		return parse_break();
+		return parse_break(context);
 	}
 
-	if (peek("goto"))
+	if (peek(context, Token_kind::keyword_goto))
 	{
-		return false;
+		return parse_goto(context);
 	}
 
 	return false;
@@ -966,27 +1377,36 @@ auto parse_control_statement() -> bool
 /*
  * compound		= "{" {statement} "}".
  */
-auto parse_compound() -> bool
+auto parse_compound(Parser_context& context) -> bool
 {
-	symbol_push_scope();
-	if (!match(Token_kind::open_brace))
+	const std::uint32_t token = context.position;
+	const std::uint32_t first = context.ast.size();
+	context.symbols.push_scope();
+	if (!match(context, Token_kind::open_brace))
 	{
 		return false;
 	}
 
-	while (!match(Token_kind::close_brace))
+	while (!match(context, Token_kind::close_brace))
 	{
-		if (!parse_statement())
+		const std::uint32_t start = context.position;
+		const std::uint32_t nodes = context.ast.size();
+		const std::size_t depth = context.symbols.depth();
+		if (!parse_statement(context))
 		{
-			return false;
+			if (!context.recover || !recover(context, Construct::statement, start, nodes, depth))
+			{
+				return false;
+			}
 		}
 	}
 
-	symbol_pop_scope();
+	context.symbols.pop_scope();
+	emit(context, Node_kind::compound, token, first);
 	return true;
 }
 
-auto parse_typedef() -> bool;
+auto parse_typedef(Parser_context& context) -> bool;
 
 /*
  * statement		= [identifier ":"]
@@ -994,368 +1414,1279 @@ auto parse_typedef() -> bool;
  * 				| construction | control_statement
  * 				| typedef).
  */
-auto parse_statement() -> bool
+auto parse_statement(Parser_context& context) -> bool
 {
-	Iterator start = s_token_iter;
-
-	if (match(Token_kind::identifier) && match(Token_kind::colon))
+	if (stack_exhausted(context))
 	{
-		return true;
+		return parse_nested(context, Nested::statement);
 	}
-	s_token_iter = start;
 
-	if (parse_simple_statement())
+	const std::uint32_t start = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (at_end(context))
 	{
-		return true;
+		return false;
 	}
-	s_token_iter = start;
 
-	if (parse_assignment())
+	const Token_buffer& tokens = input(context);
+	if (peek_name(context) && start + 1 < tokens.size() && tokens.kind(start + 1) == Token_kind::colon)
 	{
+		advance(context);
+		advance(context);
+		emit(context, Node_kind::label, start, first);
 		return true;
 	}
-	s_token_iter = start;
 
-	if (parse_construction())
+	if (tokens.kind(start) == Token_kind::keyword_typedef)
 	{
-		return true;
+		return parse_typedef(context);
 	}
-	s_token_iter = start;
 
-	if (parse_control_statement())
+	bool parsed = false;
+	++context.resetting;
+	switch (tokens.kind(start))
 	{
-		return true;
+	case Token_kind::keyword_return:
+	case Token_kind::keyword_if:
+	case Token_kind::keyword_switch:
+	case Token_kind::keyword_while:
+	case Token_kind::keyword_do:
+	case Token_kind::open_brace:
+	case Token_kind::keyword_break: {
+		parsed = parse_control_statement(context);
+	} break;
+
+	case Token_kind::keyword_goto: {
+		parsed = parse_goto(context);
+	} break;
+
+	default: {
+		parsed = parse_expression_statement(context);
+	} break;
 	}
-	s_token_iter = start;
+	--context.resetting;
 
-	if (parse_typedef())
+	// A failed statement ends where it began, as it did when each kind was tried in turn.
+	if (!parsed)
 	{
-		return true;
+		note_failure(context);
+		context.position = start;
+		context.ast.truncate(first);
 	}
-
-	return false;
+	return parsed;
+}
+
+/*
+ * Parses rule as its recursive counterpart does, but keeps the rules in
+ * progress on a stack of frames on the heap, so nesting of any depth parses
+ * in the native stack of this one call.  A parse hands off to it once it has
+ * used up its stack budget, at the same checks in parse_statement,
+ * parse_expression, parse_binary and parse_additive_list.  Expressions are
+ * parsed by precedence climbing, which builds the same tree as descent and
+ * reports the same events.
+ */
+auto parse_nested(Parser_context& context, Nested rule, unsigned power) -> bool
+{
+	context.stack_low = std::min(context.stack_low, stack_address());
+
+	std::vector<Nested_frame>& frames = context.nested;
+	frames.clear();
+	frames.push_back(Nested_frame{rule, 0, static_cast<std::uint8_t>(power)});
+	bool parsed = false;
+
+	// Continues the current rule at step once callee has parsed, with its result in parsed.
+	const auto call = [&](std::uint8_t step, Nested callee, unsigned callee_power = 0)
+	{
+		frames.back().step = step;
+		frames.push_back(Nested_frame{callee, 0, static_cast<std::uint8_t>(callee_power)});
+	};
+
+	// Continues the current rule at step as if a rule it called had returned result.
+	const auto resume = [&](std::uint8_t step, bool result)
+	{
+		frames.back().step = step;
+		parsed = result;
+	};
+
+	const auto finish = [&](bool result)
+	{
+		frames.pop_back();
+		parsed = result;
+	};
+
+	while (!frames.empty())
+	{
+		// Not used once call or finish has changed the stack.
+		Nested_frame& frame = frames.back();
+		switch (frame.rule)
+		{
+		case Nested::statement: {
+			if (frame.step != 0)
+			{
+				--context.resetting;
+				if (!parsed)
+				{
+					note_failure(context);
+					context.position = frame.start;
+					context.ast.truncate(frame.first);
+				}
+				finish(parsed);
+				break;
+			}
+
+			frame.start = context.position;
+			frame.first = context.ast.size();
+			if (at_end(context))
+			{
+				finish(false);
+				break;
+			}
+
+			const Token_buffer& tokens = input(context);
+			if (peek_name(context) && frame.start + 1 < tokens.size() && tokens.kind(frame.start + 1) == Token_kind::colon)
+			{
+				advance(context);
+				advance(context);
+				emit(context, Node_kind::label, frame.start, frame.first);
+				finish(true);
+				break;
+			}
+
+			if (tokens.kind(frame.start) == Token_kind::keyword_typedef)
+			{
+				frame.rule = Nested::typedef_declaration;
+				break;
+			}
+
+			++context.resetting;
+			switch (tokens.kind(frame.start))
+			{
+			case Token_kind::keyword_return: {
+				call(1, Nested::return_statement);
+			} break;
+
+			case Token_kind::keyword_if: {
+				call(1, Nested::conditional);
+			} break;
+
+			case Token_kind::keyword_switch: {
+				call(1, Nested::switch_statement);
+			} break;
+
+			case Token_kind::keyword_while: {
+				call(1, Nested::while_statement);
+			} break;
+
+			case Token_kind::keyword_do: {
+				call(1, Nested::do_statement);
+			} break;
+
+			case Token_kind::open_brace: {
+				call(1, Nested::compound);
+			} break;
+
+			case Token_kind::keyword_break: {
+				resume(1, parse_break(context));
+			} break;
+
+			case Token_kind::keyword_goto: {
+				resume(1, parse_goto(context));
+			} break;
+
+			default: {
+				call(1, Nested::expression_statement);
+			} break;
+			}
+		} break;
+
+		case Nested::return_statement: {
+			if (frame.step == 0)
+			{
+				frame.token = context.position;
+				frame.first = context.ast.size();
+				if (!match(context, Token_kind::keyword_return))
+				{
+					finish(false);
+				}
+				else if (!peek(context, Token_kind::semicolon))
+				{
+					call(1, Nested::expression);
+				}
+				else
+				{
+					resume(1, true);
+				}
+				break;
+			}
+
+			const bool returned = parsed && match(context, Token_kind::semicolon);
+			if (returned)
+			{
+				emit(context, Node_kind::return_statement, frame.token, frame.first);
+			}
+			finish(returned);
+		} break;
+
+		case Nested::conditional: {
+			switch (frame.step)
+			{
+			case 0: {
+				frame.token = context.position;
+				frame.first = context.ast.size();
+				if (match(context, Token_kind::keyword_if) && match(context, Token_kind::open_paren))
+				{
+					call(1, Nested::expression);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			case 1: {
+				if (parsed && match(context, Token_kind::close_paren))
+				{
+					call(2, Nested::statement);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			case 2: {
+				if (!parsed)
+				{
+					finish(false);
+				}
+				else if (match(context, Token_kind::keyword_else))
+				{
+					call(3, Nested::statement);
+				}
+				else
+				{
+					resume(3, true);
+				}
+			} break;
+
+			default: {
+				if (parsed)
+				{
+					emit(context, Node_kind::conditional, frame.token, frame.first);
+				}
+				finish(parsed);
+			} break;
+			}
+		} break;
+
+		case Nested::switch_statement: {
+			switch (frame.step)
+			{
+			case 0: {
+				frame.token = context.position;
+				frame.first = context.ast.size();
+				if (match(context, Token_kind::keyword_switch) && match(context, Token_kind::open_paren))
+				{
+					call(1, Nested::expression);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			case 1: {
+				if (parsed && match(context, Token_kind::close_paren) && match(context, Token_kind::open_brace))
+				{
+					resume(2, true);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			default: {
+				if (!parsed)
+				{
+					finish(false);
+				}
+				else if (peek(context, Token_kind::keyword_case))
+				{
+					call(2, Nested::case_clause);
+				}
+				else
+				{
+					const bool closed = match(context, Token_kind::close_brace);
+					if (closed)
+					{
+						emit(context, Node_kind::switch_statement, frame.token, frame.first);
+					}
+					finish(closed);
+				}
+			} break;
+			}
+		} break;
+
+		case Nested::case_clause:
+		case Nested::compound: {
+			const bool compound = frame.rule == Nested::compound;
+			switch (frame.step)
+			{
+			case 0: {
+				frame.token = context.position;
+				frame.first = context.ast.size();
+				if (compound)
+				{
+					context.symbols.push_scope();
+				}
+
+				if (match(context, compound ? Token_kind::open_brace : Token_kind::keyword_case))
+				{
+					resume(1, true);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			case 1: {
+				const bool done = compound ? match(context, Token_kind::close_brace) : peek(context, Token_kind::close_brace) || peek(context, Token_kind::keyword_break);
+				if (done)
+				{
+					if (compound)
+					{
+						context.symbols.pop_scope();
+					}
+					emit(context, compound ? Node_kind::compound : Node_kind::case_clause, frame.token, frame.first);
+					finish(true);
+				}
+				else
+				{
+					frame.start = context.position;
+					frame.nodes = context.ast.size();
+					frame.depth = context.symbols.depth();
+					call(2, Nested::statement);
+				}
+			} break;
+
+			default: {
+				if (parsed || (context.recover && recover(context, Construct::statement, frame.start, frame.nodes, frame.depth)))
+				{
+					resume(1, true);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+			}
+		} break;
+
+		case Nested::while_statement: {
+			switch (frame.step)
+			{
+			case 0: {
+				frame.token = context.position;
+				frame.first = context.ast.size();
+				if (match(context, Token_kind::keyword_while) && match(context, Token_kind::open_paren))
+				{
+					call(1, Nested::expression);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			case 1: {
+				if (parsed && match(context, Token_kind::close_paren))
+				{
+					call(2, Nested::statement);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			default: {
+				if (parsed)
+				{
+					emit(context, Node_kind::while_statement, frame.token, frame.first);
+				}
+				finish(parsed);
+			} break;
+			}
+		} break;
+
+		case Nested::do_statement: {
+			switch (frame.step)
+			{
+			case 0: {
+				frame.token = context.position;
+				frame.first = context.ast.size();
+				if (match(context, Token_kind::keyword_do))
+				{
+					call(1, Nested::statement);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			case 1: {
+				if (parsed && match(context, Token_kind::keyword_while) && match(context, Token_kind::open_paren))
+				{
+					call(2, Nested::expression);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			default: {
+				const bool closed = parsed && match(context, Token_kind::close_paren) && match(context, Token_kind::semicolon);
+				if (closed)
+				{
+					emit(context, Node_kind::do_statement, frame.token, frame.first);
+				}
+				finish(closed);
+			} break;
+			}
+		} break;
+
+		// Steps 3 and 4 take the initialization of a construction in parentheses and after "=".
+		case Nested::expression_statement: {
+			switch (frame.step)
+			{
+			case 0: {
+				frame.start = context.position;
+				frame.first = context.ast.size();
+				call(1, Nested::expression);
+			} break;
+
+			case 1: {
+				frame.token = context.position;
+				if (!parsed)
+				{
+					finish(false);
+				}
+				else if (match(context, Token_kind::semicolon))
+				{
+					emit(context, Node_kind::expression_statement, frame.start, frame.first);
+					finish(true);
+				}
+				else if (match(context, Token_kind::equals))
+				{
+					call(2, Nested::expression);
+				}
+				else if (!match_name(context))
+				{
+					finish(false);
+				}
+				else if (peek(context, Token_kind::semicolon))
+				{
+					resume(4, true);
+				}
+				else if (match(context, Token_kind::open_paren))
+				{
+					call(3, Nested::expression);
+				}
+				else if (match(context, Token_kind::equals))
+				{
+					call(4, Nested::expression);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			case 2: {
+				const bool assigned = parsed && match(context, Token_kind::semicolon);
+				if (assigned)
+				{
+					emit(context, Node_kind::assignment, frame.token, frame.first);
+				}
+				finish(assigned);
+			} break;
+
+			case 3: {
+				if (!parsed)
+				{
+					finish(false);
+				}
+				else if (match(context, Token_kind::comma))
+				{
+					call(3, Nested::expression);
+				}
+				else
+				{
+					resume(4, match(context, Token_kind::close_paren));
+				}
+			} break;
+
+			default: {
+				const bool constructed = parsed && match(context, Token_kind::semicolon);
+				if (constructed)
+				{
+					emit(context, Node_kind::construction, frame.token, frame.first);
+				}
+				finish(constructed);
+			} break;
+			}
+		} break;
+
+		case Nested::typedef_declaration: {
+			if (frame.step == 0)
+			{
+				frame.first = context.ast.size();
+				if (match(context, Token_kind::keyword_typedef))
+				{
+					call(1, Nested::expression);
+				}
+				else
+				{
+					finish(false);
+				}
+				break;
+			}
+
+			const std::uint32_t name = context.position;
+			if (!parsed || !peek_name(context) || !context.symbols.push(current_atom(context), Symbol_kind::type))
+			{
+				finish(false);
+				break;
+			}
+			advance(context);
+
+			const bool declared = match(context, Token_kind::semicolon);
+			if (declared)
+			{
+				emit(context, Node_kind::typedef_declaration, name, frame.first);
+			}
+			finish(declared);
+		} break;
+
+		case Nested::expression: {
+			if (frame.step == 0)
+			{
+				frame.start = context.position;
+				call(1, Nested::binary, 1);
+				break;
+			}
+
+			if (parsed && context.events)
+			{
+				context.events->on_expression_end(input(context), frame.start, context.position);
+			}
+			finish(parsed);
+		} break;
+
+		case Nested::binary: {
+			switch (frame.step)
+			{
+			case 0: {
+				frame.first = context.ast.size();
+				call(1, Nested::operand);
+			} break;
+
+			case 1: {
+				if (!parsed)
+				{
+					finish(false);
+					break;
+				}
+
+				const Token_kind kind = at_end(context) ? Token_kind::invalid : input(context).kind(context.position);
+				const unsigned left = s_binding_powers[static_cast<std::uint8_t>(kind)];
+				if (left == 0 || left < frame.power)
+				{
+					finish(true);
+					break;
+				}
+
+				// Descent parses the right of "&&" as an expression, which reports its own event.
+				frame.token = context.position;
+				advance(context);
+				if (kind == Token_kind::double_ampersand && context.expressions == Expressions::descent)
+				{
+					call(2, Nested::expression);
+				}
+				else
+				{
+					call(2, Nested::binary, kind == Token_kind::double_ampersand ? 1 : left + 1);
+				}
+			} break;
+
+			default: {
+				if (parsed)
+				{
+					emit(context, Node_kind::binary, frame.token, frame.first);
+					resume(1, true);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+			}
+		} break;
+
+		// A prefix expression: the primary, then each postfix operator from step 3 on, then the prefix operator.
+		case Nested::operand: {
+			switch (frame.step)
+			{
+			case 0: {
+				frame.token = context.position;
+				frame.first = context.ast.size();
+				frame.unary = match(context, Token_kind::minus) || match(context, Token_kind::bang) || match(context, Token_kind::keyword_const);
+				frame.start = context.position;
+
+				if (peek(context, Token_kind::identifier))
+				{
+					const Symbol* symbol = lookup(context, current_atom(context));
+					if (symbol && (symbol->kind == Symbol_kind::type || symbol->kind == Symbol_kind::procedure))
+					{
+						advance(context);
+						if (match(context, Token_kind::less))
+						{
+							call(1, Nested::additive_list);
+						}
+						else
+						{
+							emit(context, Node_kind::name, frame.start, frame.first);
+							resume(3, true);
+						}
+						break;
+					}
+				}
+
+				if (match(context, Token_kind::keyword_true) || match(context, Token_kind::keyword_false) || match(context, Token_kind::integer) || match(context, Token_kind::real))
+				{
+					emit(context, Node_kind::literal, frame.start, frame.first);
+					resume(3, true);
+				}
+				else if (match(context, Token_kind::open_paren))
+				{
+					call(2, Nested::expression);
+				}
+				else if (match(context, Token_kind::keyword_bool) || match(context, Token_kind::keyword_int) || match(context, Token_kind::keyword_double) || match(context, Token_kind::keyword_typename))
+				{
+					emit(context, Node_kind::basic_type, frame.start, frame.first);
+					resume(3, true);
+				}
+				else if (match(context, Token_kind::identifier))
+				{
+					emit(context, Node_kind::name, frame.start, frame.first);
+					resume(3, true);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			case 1: {
+				if (parsed && match(context, Token_kind::greater))
+				{
+					emit(context, Node_kind::template_instance, frame.start, frame.first);
+					resume(3, true);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			case 2: {
+				if (parsed && match(context, Token_kind::close_paren))
+				{
+					resume(3, true);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			case 3: {
+				frame.start = context.position;
+				if (match(context, Token_kind::dot))
+				{
+					if (match_name(context))
+					{
+						emit(context, Node_kind::member, frame.start + 1, frame.first);
+						resume(3, true);
+					}
+					else
+					{
+						finish(false);
+					}
+				}
+				else if (match(context, Token_kind::open_paren))
+				{
+					if (peek(context, Token_kind::close_paren))
+					{
+						resume(5, true);
+					}
+					else
+					{
+						call(4, Nested::expression);
+					}
+				}
+				else if (match(context, Token_kind::open_bracket))
+				{
+					call(6, Nested::expression);
+				}
+				else if (match(context, Token_kind::ampersand))
+				{
+					emit(context, Node_kind::address, frame.start, frame.first);
+					resume(3, true);
+				}
+				else
+				{
+					if (frame.unary)
+					{
+						emit(context, Node_kind::prefix, frame.token, frame.first);
+					}
+					finish(true);
+				}
+			} break;
+
+			case 4: {
+				if (!parsed)
+				{
+					finish(false);
+				}
+				else if (match(context, Token_kind::comma))
+				{
+					call(4, Nested::expression);
+				}
+				else
+				{
+					resume(5, true);
+				}
+			} break;
+
+			case 5: {
+				if (match(context, Token_kind::close_paren))
+				{
+					emit(context, Node_kind::call, frame.start, frame.first);
+					resume(3, true);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+
+			default: {
+				if (parsed && match(context, Token_kind::close_bracket))
+				{
+					emit(context, Node_kind::subscript, frame.start, frame.first);
+					resume(3, true);
+				}
+				else
+				{
+					finish(false);
+				}
+			} break;
+			}
+		} break;
+
+		case Nested::additive_list: {
+			if (frame.step == 0 || (parsed && match(context, Token_kind::comma)))
+			{
+				call(1, Nested::binary, s_additive_power);
+			}
+			else
+			{
+				finish(parsed);
+			}
+		} break;
+		}
+	}
+
+	return parsed;
+}
+
+// The end of the block starting here if its braces balance, or 0.
+auto find_block_end(Parser_context& context) -> std::uint32_t
+{
+	switch (context.bodies)
+	{
+	case Bodies::defer: {
+		const auto iter = std::lower_bound(context.declarations.begin(), context.declarations.end(), context.position,
+			[](const Declaration_span& span, std::uint32_t position) { return span.body_begin < position; });
+		if (iter != context.declarations.end() && iter->body_begin == context.position)
+		{
+			return iter->body_end;
+		}
+	} break;
+
+	case Bodies::skip: {
+		const Token_buffer& tokens = input(context);
+		std::uint32_t depth = 0;
+		for (std::uint32_t i = context.position; i < tokens.size(); ++i)
+		{
+			const Token_kind kind = tokens.kind(i);
+			if (kind == Token_kind::open_brace)
+			{
+				++depth;
+			}
+			else if (kind == Token_kind::close_brace && --depth == 0)
+			{
+				return i + 1;
+			}
+		}
+	} break;
+
+	default: {
+	} break;
+	}
+
+	return 0;
 }
 
 /*
  * body		= compound.
  */
-auto parse_body() -> bool
+auto parse_body(Parser_context& context) -> bool
 {
-	return parse_compound();
+	if (context.bodies != Bodies::parse && peek(context, Token_kind::open_brace))
+	{
+		if (const std::uint32_t end = find_block_end(context))
+		{
+			const std::uint32_t node = context.ast.size();
+			context.deferred.push_back(Deferred_body{context.position, end, context.symbols.pushes(), node});
+			emit(context, Node_kind::deferred_body, context.position, node);
+			context.position = end;
+			return true;
+		}
+	}
+
+	return parse_compound(context);
 }
 
 /*
  * constructor	= structure_name "(" [parameter_list] ")" [":" initializer_list] body.
  */
-auto parse_constructor(const Symbol& symbol) -> bool
+auto parse_constructor(Parser_context& context, const Symbol& symbol) -> bool
 {
-	if (!match(symbol.name))
+	const std::uint32_t name = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!match_name(context, symbol.name))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_paren))
+	if (!match(context, Token_kind::open_paren))
 	{
 		return false;
 	}
 
-	if (!peek(Token_kind::close_paren))
+	if (!peek(context, Token_kind::close_paren))
 	{
-		if (!parse_parameter_list())
+		if (!parse_parameter_list(context))
 		{
 			return false;
 		}
 	}
 
-	if (!match(Token_kind::close_paren))
+	if (!match(context, Token_kind::close_paren))
 	{
 		return false;
 	}
 
-	if (match(Token_kind::colon))
+	if (match(context, Token_kind::colon))
 	{
-		if (!parse_initializer_list())
+		if (!parse_initializer_list(context))
 		{
 			return false;
 		}
 	}
 
-	if (!parse_body())
+	if (!parse_body(context))
 	{
 		return false;
 	}
 
+	emit(context, Node_kind::constructor, name, first);
 	return true;
 }
 
+/*
+ * The expression that begins a data member, apply or index operator, parsed
+ * again by each of them in turn, so its events wait until one of them has
+ * seen the tokens that follow it.
+ */
+auto parse_member_expression(Parser_context& context) -> bool
+{
+	Parse_events* events = context.events;
+	const std::uint32_t first = context.ast.size();
+	context.events = nullptr;
+	const bool parsed = parse_memoized(context, Rule::member_expression, parse_expression);
+	context.events = events;
+
+	// Without events to report to it built a tree as well, which an event parse has no use for.
+	if (events)
+	{
+		context.ast.truncate(first);
+	}
+	return parsed;
+}
+
+auto report_member_expression(Parser_context& context, std::uint32_t begin, std::uint32_t end) -> void
+{
+	if (context.events)
+	{
+		context.events->on_expression_end(input(context), begin, end);
+	}
+}
+
 /*
  * data_member		= expression identifier ["[" expression "]"] ";".
  */
-auto parse_data_member() -> bool
+auto parse_data_member(Parser_context& context) -> bool
 {
-	if (!parse_expression())
+	const std::uint32_t start = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!parse_member_expression(context))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::identifier))
+	const std::uint32_t name = context.position;
+	if (!match_name(context))
 	{
 		return false;
 	}
 
-	if (match(Token_kind::open_bracket))
+	if (match(context, Token_kind::open_bracket))
 	{
-		if (!parse_expression())
+		if (!parse_expression(context))
 		{
 			return false;
 		}
 
-		if (!match(Token_kind::close_bracket))
+		if (!match(context, Token_kind::close_bracket))
 		{
 			return false;
 		}
 	}
 
-	return match(Token_kind::semicolon);
+	if (!match(context, Token_kind::semicolon))
+	{
+		return false;
+	}
+
+	// The name may be "operator", so only the ";" tells this from an operator.
+	report_member_expression(context, start, name);
+	emit(context, Node_kind::data_member, name, first);
+	return true;
 }
 
 /*
  * destructor		= "~" structure_name "(" ")" body.
  */
-auto parse_destructor(const Symbol& symbol) -> bool
+auto parse_destructor(Parser_context& context, const Symbol& symbol) -> bool
 {
-	if (!match(Token_kind::tilde))
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::tilde))
+	{
+		return false;
+	}
+
+	const std::uint32_t name = context.position;
+	if (!match_name(context, symbol.name))
 	{
 		return false;
 	}
 
-	if (!match(symbol.name))
+	if (!match(context, Token_kind::open_paren))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_paren))
+	if (!match(context, Token_kind::close_paren))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::close_paren))
+	if (!parse_body(context))
 	{
 		return false;
 	}
 
-	return parse_body();
+	emit(context, Node_kind::destructor, name, first);
+	return true;
 }
 
 /*
  * assign		= "void" "operator" "=" "(" parameter ")" body.
  */
-auto parse_assign() -> bool
+auto parse_assign(Parser_context& context) -> bool
 {
-	if (!match("void"))
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_void))
+	{
+		return false;
+	}
+
+	const std::uint32_t token = context.position;
+	if (!match(context, Token_kind::keyword_operator))
 	{
 		return false;
 	}
 
-	if (!match("operator"))
+	if (!match(context, Token_kind::equals))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::equals))
+	if (!match(context, Token_kind::open_paren))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_paren))
+	if (!parse_parameter(context))
 	{
 		return false;
 	}
 
-	if (!parse_parameter())
+	if (!match(context, Token_kind::close_paren))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::close_paren))
+	if (!parse_body(context))
 	{
 		return false;
 	}
 
-	return parse_body();
+	emit(context, Node_kind::assign_operator, token, first);
+	return true;
 }
 
 /*
  * index		= expression "operator" "[" "]" "(" parameter ")" body.
  */
-auto parse_index() -> bool
+auto parse_index(Parser_context& context) -> bool
 {
-	if (!parse_expression())
+	const std::uint32_t start = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!parse_member_expression(context))
+	{
+		return false;
+	}
+
+	const std::uint32_t token = context.position;
+	if (!match(context, Token_kind::keyword_operator))
 	{
 		return false;
 	}
 
-	if (!match("operator"))
+	if (!match(context, Token_kind::open_bracket))
 	{
 		return false;
 	}
+	report_member_expression(context, start, token);
 
-	if (!match(Token_kind::open_bracket))
+	if (!match(context, Token_kind::close_bracket))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::close_bracket))
+	if (!match(context, Token_kind::open_paren))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_paren))
+	if (!parse_parameter(context))
 	{
 		return false;
 	}
 
-	if (!parse_parameter())
+	if (!match(context, Token_kind::close_paren))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::close_paren))
+	if (!parse_body(context))
 	{
 		return false;
 	}
 
-	return parse_body();
+	emit(context, Node_kind::index_operator, token, first);
+	return true;
 }
 
 
 /*
  * typedef		= "typedef" expression identifier ";".
  */
-auto parse_typedef() -> bool
+auto parse_typedef(Parser_context& context) -> bool
 {
-	if (!match("typedef"))
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_typedef))
 	{
 		return false;
 	}
 
-	if (!parse_expression())
+	if (!parse_expression(context))
 	{
 		return false;
 	}
 
-	if (!peek(Token_kind::identifier))
+	if (!peek_name(context))
 	{
 		return false;
 	}
 
-	const Symbol* symbol = symbol_push(s_token_iter->begin, s_token_iter->end, Symbol_kind::type);
+	const std::uint32_t name = context.position;
+	const Symbol* symbol = context.symbols.push(current_atom(context), Symbol_kind::type);
 	if (!symbol)
 	{
 		return false;
 	}
-	++s_token_iter;
+	advance(context);
+
+	if (!match(context, Token_kind::semicolon))
+	{
+		return false;
+	}
 
-	return match(Token_kind::semicolon);
+	emit(context, Node_kind::typedef_declaration, name, first);
+	return true;
 }
 
 /*
  * apply		= expression "operator" "(" ")" "(" [parameter_list] ")" body.
  */
-auto parse_apply() -> bool
+auto parse_apply(Parser_context& context) -> bool
 {
-	if (!parse_expression())
+	const std::uint32_t start = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!parse_member_expression(context))
 	{
 		return false;
 	}
 
-	if (!match("operator"))
+	const std::uint32_t token = context.position;
+	if (!match(context, Token_kind::keyword_operator))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_paren))
+	if (!match(context, Token_kind::open_paren))
 	{
 		return false;
 	}
+	report_member_expression(context, start, token);
 
-	if (!match(Token_kind::close_paren))
+	if (!match(context, Token_kind::close_paren))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_paren))
+	if (!match(context, Token_kind::open_paren))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::close_paren))
+	if (!match(context, Token_kind::close_paren))
 	{
-		if (!parse_parameter_list())
+		if (!parse_parameter_list(context))
 		{
 			return false;
 		}
 
-		if (!match(Token_kind::close_paren))
+		if (!match(context, Token_kind::close_paren))
 		{
 			return false;
 		}
 	}
 
-	return parse_body();
+	if (!parse_body(context))
+	{
+		return false;
+	}
+
+	emit(context, Node_kind::apply_operator, token, first);
+	return true;
 }
 
 /*
  * member		= data_member | constructor | destructor | assign | apply | index | typedef.
  */
-auto parse_member(const Symbol& symbol) -> bool
+auto parse_member(Parser_context& context, const Symbol& symbol) -> bool
 {
-	if (peek(symbol.name))
+	if (peek_name(context, symbol.name))
 	{
-		if (!parse_constructor(symbol))
+		if (!parse_constructor(context, symbol))
 		{
 			return false;
 		}
 	}
-	else if (peek(Token_kind::tilde))
+	else if (peek(context, Token_kind::tilde))
 	{
-		if (!parse_destructor(symbol))
+		if (!parse_destructor(context, symbol))
 		{
 			return false;
 		}
 	}
-	else if (peek("typedef"))
+	else if (peek(context, Token_kind::keyword_typedef))
 	{
-		return parse_typedef();
+		return parse_typedef(context);
 	}
 	else
 	{
-		Iterator start = s_token_iter;
+		const std::uint32_t start = context.position;
+		const std::uint32_t first = context.ast.size();
+		++context.resetting;
 
-		if (parse_data_member())
+		if (parse_data_member(context))
 		{
+			--context.resetting;
 			return true;
 		}
-		s_token_iter = start;
+		note_failure(context);
+		context.position = start;
+		context.ast.truncate(first);
 
-		if (parse_assign())
+		if (parse_assign(context))
 		{
+			--context.resetting;
 			return true;
 		}
-		s_token_iter = start;
+		note_failure(context);
+		context.position = start;
+		context.ast.truncate(first);
 
-		if (parse_apply())
+		if (parse_apply(context))
 		{
+			--context.resetting;
 			return true;
 		}
-		s_token_iter = start;
+		note_failure(context);
+		context.position = start;
+		context.ast.truncate(first);
 
-		if (parse_index())
+		if (parse_index(context))
 		{
+			--context.resetting;
 			return true;
 		}
 
-		s_token_iter = start;
+		note_failure(context);
+		context.position = start;
+		context.ast.truncate(first);
+		--context.resetting;
 		return false;
 	}
 
@@ -1365,18 +2696,24 @@ auto parse_member(const Symbol& symbol) -> bool
 /*
  * structure_body	= "{" {member} "}".
  */
-auto parse_structure_body(const Symbol& symbol) -> bool
+auto parse_structure_body(Parser_context& context, const Symbol& symbol) -> bool
 {
-	if (!match(Token_kind::open_brace))
+	if (!match(context, Token_kind::open_brace))
 	{
 		return false;
 	}
 
-	while (!match(Token_kind::close_brace))
+	while (!match(context, Token_kind::close_brace))
 	{
-		if (!parse_member(symbol))
+		const std::uint32_t start = context.position;
+		const std::uint32_t nodes = context.ast.size();
+		const std::size_t depth = context.symbols.depth();
+		if (!parse_member(context, symbol))
 		{
-			return false;
+			if (!context.recover || !recover(context, Construct::member, start, nodes, depth))
+			{
+				return false;
+			}
 		}
 	}
 
@@ -1386,46 +2723,61 @@ auto parse_structure_body(const Symbol& symbol) -> bool
 /*
  * structure		= "struct" structure_name [structure_body] ";".
  */
-auto parse_structure() -> bool
+auto parse_structure(Parser_context& context) -> bool
 {
-	if (!match("struct"))
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_struct))
 	{
 		return false;
 	}
 
-	const Symbol* symbol = parse_structure_name();
+	const std::uint32_t name = context.position;
+	const Symbol* symbol = parse_structure_name(context);
 	if (!symbol)
 	{
 		return false;
 	}
 
-	if (match(Token_kind::semicolon))
+	// A specialization in a template is tried after a structure.
+	if (context.events && (peek(context, Token_kind::semicolon) || peek(context, Token_kind::open_brace)))
 	{
+		context.events->on_struct(input(context), name);
+	}
+
+	if (match(context, Token_kind::semicolon))
+	{
+		emit(context, Node_kind::structure, name, first);
 		return true;
 	}
 
-	if (!parse_structure_body(*symbol))
+	if (!parse_structure_body(context, *symbol))
+	{
+		return false;
+	}
+
+	if (!match(context, Token_kind::semicolon))
 	{
 		return false;
 	}
 
-	return match(Token_kind::semicolon);
+	emit(context, Node_kind::structure, name, first);
+	return true;
 }
 
 /*
  * procedure_name	= identifier | operator.
  * operator		= "operator" ("==" | "<" | "+" | "-" | "*" | "/" | "%").
  */
-auto parse_procedure_name() -> bool
+auto parse_procedure_name(Parser_context& context) -> bool
 {
-	if (match("operator"))
+	if (match(context, Token_kind::keyword_operator))
 	{
-		if (s_token_iter == s_token_end)
+		if (at_end(context))
 		{
 			return false;
 		}
 
-		switch (s_token_iter->kind)
+		switch (input(context).kind(context.position))
 		{
 		case Token_kind::double_equals:
 		case Token_kind::less:
@@ -1434,7 +2786,7 @@ auto parse_procedure_name() -> bool
 		case Token_kind::star:
 		case Token_kind::forward_slash:
 		case Token_kind::percent: {
-			++s_token_iter;
+			advance(context);
 			return true;
 		} break;
 
@@ -1445,14 +2797,14 @@ auto parse_procedure_name() -> bool
 	}
 	else
 	{
-		if (!peek(Token_kind::identifier))
+		if (!peek_name(context))
 		{
 			return false;
 		}
 
 		// TODO Should we check the returned result to see if it was a procedure?
-		symbol_push(s_token_iter->begin, s_token_iter->end, Symbol_kind::procedure);
-		++s_token_iter;
+		context.symbols.push(current_atom(context), Symbol_kind::procedure);
+		advance(context);
 		return true;
 	}
 }
@@ -1460,214 +2812,576 @@ auto parse_procedure_name() -> bool
 /*
  * procedure		= (expression | "void") procedure_name "(" [parameter_list] ")" (body | ";").
  */
-auto parse_procedure() -> bool
+auto parse_procedure(Parser_context& context) -> bool
 {
-	if (!match("void") && !parse_expression())
+	const std::uint32_t first = context.ast.size();
+	if (match(context, Token_kind::keyword_void))
+	{
+		emit(context, Node_kind::basic_type, context.position - 1, first);
+	}
+	else if (!parse_expression(context))
 	{
 		return false;
 	}
 
-	if (!parse_procedure_name())
+	const std::uint32_t name = context.position;
+	if (!parse_procedure_name(context))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_paren))
+	if (context.events)
+	{
+		context.events->on_procedure_begin(input(context), name);
+	}
+
+	if (!match(context, Token_kind::open_paren))
 	{
 		return false;
 	}
 
-	if (!peek(Token_kind::close_paren))
+	std::uint32_t parameters = 0;
+	if (!peek(context, Token_kind::close_paren))
 	{
 		do
 		{
-			if (!parse_parameter())
+			if (!parse_parameter(context))
 			{
 				return false;
 			}
+			++parameters;
 		}
-		while (match(Token_kind::comma));
+		while (match(context, Token_kind::comma));
 	}
 
-	if (!match(Token_kind::close_paren))
+	if (!match(context, Token_kind::close_paren))
 	{
 		return false;
 	}
 
-	if (match(Token_kind::semicolon))
+	if (!match(context, Token_kind::semicolon))
 	{
-		return true;
+		if (!parse_body(context))
+		{
+			return false;
+		}
+	}
+
+	if (context.events)
+	{
+		context.events->on_procedure_end(input(context), name, parameters);
 	}
 
-	return parse_body();
+	emit(context, Node_kind::procedure, name, first);
+	return true;
 }
 
 /*
  * constraint		= "requires" "(" expression ")".
  */
-auto parse_constraint() -> bool
+auto parse_constraint(Parser_context& context) -> bool
 {
-	if (!match("requires"))
+	const std::uint32_t token = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_requires))
+	{
+		return false;
+	}
+
+	if (!match(context, Token_kind::open_paren))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::open_paren))
+	if (!parse_expression(context))
 	{
 		return false;
 	}
 
-	if (!parse_expression())
+	if (!match(context, Token_kind::close_paren))
 	{
 		return false;
 	}
 
-	return match(Token_kind::close_paren);
+	emit(context, Node_kind::constraint, token, first);
+	return true;
 }
 
 /*
  * template_decl	= "template" "<" [parameter_list] ">" [constraint].
  */
-auto parse_template_decl() -> bool
+auto parse_template_decl(Parser_context& context) -> bool
 {
-	if (!match("template"))
+	const std::uint32_t token = context.position;
+	if (!match(context, Token_kind::keyword_template))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::less))
+	if (!match(context, Token_kind::less))
 	{
 		return false;
 	}
 
-	if (!peek(Token_kind::greater))
+	if (!peek(context, Token_kind::greater))
 	{
-		if (!parse_parameter_list())
+		if (!parse_parameter_list(context))
 		{
 			return false;
 		}
 	}
 
-	if (!match(Token_kind::greater))
+	if (!match(context, Token_kind::greater))
 	{
 		return false;
 	}
 
-	if (peek("requires"))
+	if (peek(context, Token_kind::keyword_requires))
 	{
-		return parse_constraint();
+		if (!parse_constraint(context))
+		{
+			return false;
+		}
 	}
 
+	if (context.events)
+	{
+		context.events->on_template_decl(input(context), token);
+	}
 	return true;
 }
 
 /*
  * specialization	= "struct" structure_name "<" additive_list ">" [structure_body] ";".
  */
-auto parse_specialization() -> bool
+auto parse_specialization(Parser_context& context) -> bool
 {
-	if (!match("struct"))
+	const std::uint32_t first = context.ast.size();
+	if (!match(context, Token_kind::keyword_struct))
 	{
 		return false;
 	}
 
-	const Symbol* symbol = parse_structure_name();
+	const std::uint32_t name = context.position;
+	const Symbol* symbol = parse_structure_name(context);
 	if (!symbol)
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::less))
+	if (!match(context, Token_kind::less))
 	{
 		return false;
 	}
 
-	if (!parse_additive_list())
+	if (!parse_additive_list(context))
 	{
 		return false;
 	}
 
-	if (!match(Token_kind::greater))
+	if (!match(context, Token_kind::greater))
 	{
 		return false;
 	}
 
-	if (!peek(Token_kind::semicolon))
+	if (context.events)
+	{
+		context.events->on_struct(input(context), name);
+	}
+
+	if (!peek(context, Token_kind::semicolon))
 	{
-		if (!parse_structure_body(*symbol))
+		if (!parse_structure_body(context, *symbol))
 		{
 			return false;
 		}
 	}
 
-	if (!match(Token_kind::semicolon))
+	if (!match(context, Token_kind::semicolon))
 	{
 		return false;
 	}
 
+	emit(context, Node_kind::specialization, name, first);
 	return true;
 }
 
 /*
  * template		= template_decl (structure | procedure | specialization).
  */
-auto parse_template() -> bool
+auto parse_template(Parser_context& context) -> bool
 {
-	if (!parse_template_decl())
+	const std::uint32_t token = context.position;
+	const std::uint32_t first = context.ast.size();
+	if (!parse_template_decl(context))
 	{
 		return false;
 	}
 
-	if (peek("struct"))
+	if (peek(context, Token_kind::keyword_struct))
 	{
-		Iterator start = s_token_iter;
+		const std::uint32_t start = context.position;
+		const std::uint32_t nodes = context.ast.size();
+		const std::size_t deferred = context.deferred.size();
 
-		if (parse_structure())
+		if (parse_structure(context))
 		{
+			emit(context, Node_kind::template_declaration, token, first);
 			return true;
 		}
-		s_token_iter = start;
+		context.position = start;
+		context.ast.truncate(nodes);
+		context.deferred.resize(deferred);
 
-		if (parse_specialization())
+		if (parse_specialization(context))
 		{
+			emit(context, Node_kind::template_declaration, token, first);
 			return true;
 		}
+		context.ast.truncate(nodes);
+		context.deferred.resize(deferred);
+	}
+
+	if (!parse_procedure(context))
+	{
+		return false;
 	}
 
-	return parse_procedure();
+	emit(context, Node_kind::template_declaration, token, first);
+	return true;
 }
 
 
-auto parse_declaration() -> bool
+auto parse_declaration(Parser_context& context) -> bool
 {
-	if (peek("enum"))
+	if (peek(context, Token_kind::keyword_enum))
 	{
-		return parse_enumeration();
+		return parse_enumeration(context);
 	}
-	else if (peek("struct"))
+	else if (peek(context, Token_kind::keyword_struct))
 	{
-		return parse_structure();
+		return parse_structure(context);
 	}
-	else if (peek("template"))
+	else if (peek(context, Token_kind::keyword_template))
 	{
-		return parse_template();
+		return parse_template(context);
 	}
 
-	return parse_procedure();
+	return parse_procedure(context);
 }
 
 auto parse(const char* begin, const char* end) -> bool
 {
-	symbols_initialize();
+	Parser_context context;
+	return parse(context, begin, end);
+}
+
+auto parse(const char* begin, const char* end, Parse_stats& stats) -> bool
+{
+	Parser_context context;
+	const bool result = parse(context, begin, end);
+	stats.tokens = context.tokens.size();
+	stats.tokens_visited = context.visited;
+	return result;
+}
+
+auto find_declarations(const Token_buffer& tokens) -> std::vector<Declaration_span>
+{
+	std::vector<Declaration_span> declarations;
+	const std::uint32_t size = tokens.size();
+	std::uint32_t begin = 0;
+	std::uint32_t body_begin = size;
+	std::uint32_t body_end = size;
+	std::uint32_t depth = 0;
+
+	auto finish = [&](std::uint32_t end) {
+		declarations.push_back(Declaration_span{begin, end, body_begin, body_end});
+		begin = end;
+		body_begin = size;
+		body_end = size;
+	};
+
+	for (std::uint32_t i = 0; i < size; ++i)
+	{
+		switch (tokens.kind(i))
+		{
+		case Token_kind::open_brace: {
+			if (depth++ == 0 && body_begin == size)
+			{
+				body_begin = i;
+			}
+		} break;
+
+		case Token_kind::close_brace: {
+			if (depth == 0)
+			{
+				return declarations;
+			}
+
+			if (--depth == 0)
+			{
+				if (body_end == size)
+				{
+					body_end = i + 1;
+				}
+
+				if (i + 1 == size || tokens.kind(i + 1) != Token_kind::semicolon)
+				{
+					finish(i + 1);
+				}
+			}
+		} break;
+
+		case Token_kind::semicolon: {
+			if (depth == 0)
+			{
+				finish(i + 1);
+			}
+		} break;
+
+		default: {
+		} break;
+		}
+	}
+
+	if (begin != size)
+	{
+		if (depth != 0)
+		{
+			body_begin = size;
+			body_end = size;
+		}
+		finish(size);
+	}
+
+	return declarations;
+}
+
+auto parse_tokens(Parser_context& context) -> bool
+{
+	context.position = 0;
+	context.visited = 0;
+	context.symbols.clear();
+	context.ast.clear();
+	context.memo.clear();
+	limit_stack(context);
+
+	context.diagnostics.clear();
+	context.stopped = 0;
+	context.resetting = 0;
+	context.passes = true;
+
+	// Tokens past 4 GiB would have no offset, so such an input is never lexed.
+	if (context.tokens.too_large())
+	{
+		return false;
+	}
+
+	while (!at_end(context))
+	{
+		const std::uint32_t start = context.position;
+		const std::uint32_t first = context.ast.size();
+		const std::size_t deferred = context.deferred.size();
+		if (!parse_declaration(context))
+		{
+			context.deferred.resize(deferred);
+			if (context.recover && recover(context, Construct::declaration, start, first, 1))
+			{
+				continue;
+			}
+
+			// A declaration cut off by the end of the input is accepted but has no tree.
+			if (!context.recover)
+			{
+				context.ast.truncate(first);
+			}
+			break;
+		}
+	}
+
+	if (!at_end(context))
+	{
+		return false;
+	}
+
+	emit(context, Node_kind::unit, context.position, 0);
+	return context.diagnostics.empty() || context.passes;
+}
+
+auto parse(Parser_context& context, const char* begin, const char* end) -> bool
+{
+	context.tokens = Token_buffer(begin, end, Lex_options{Trivia::drop, true, context.atoms});
+	return parse_tokens(context);
+}
+
+auto parse(Parser_context& context, const Source_file& file) -> bool
+{
+	context.tokens = Token_buffer(file, Lex_options{Trivia::drop, true, context.atoms});
+	return parse_tokens(context);
+}
+
+auto parse(Parser_context& context, Parse_events& events) -> bool
+{
+	const Bodies bodies = context.bodies;
+	context.bodies = Bodies::parse;
+	context.events = &events;
+	const bool parsed = parse_tokens(context);
+	context.events = nullptr;
+	context.bodies = bodies;
+	return parsed;
+}
+
+auto parse(Parser_context& context, const char* begin, const char* end, Parse_events& events) -> bool
+{
+	context.tokens = Token_buffer(begin, end, Lex_options{Trivia::drop, true, context.atoms});
+	return parse(context, events);
+}
+
+auto parse_more(Parser_context& context, const char* begin, const char* end) -> bool
+{
+	context.tokens = Token_buffer(begin, end, Lex_options{Trivia::drop, true, context.atoms});
+	context.position = 0;
+	context.visited = 0;
+	context.ast.clear();
+	context.memo.clear();
+	limit_stack(context);
+	if (context.tokens.too_large())
+	{
+		return false;
+	}
+
+	while (!at_end(context))
+	{
+		if (!parse_declaration(context))
+		{
+			return false;
+		}
+	}
+
+	emit(context, Node_kind::unit, context.position, 0);
+	return true;
+}
+
+/*
+ * Procedure bodies declare nothing outside themselves, and no scope that is
+ * open where a body starts is popped before the declaration pass ends, so the
+ * global table at the end of the pass, cut at a body's watermark, is exactly
+ * what a serial parse would see in that body.  A body that fails fails the
+ * serial parse too, before its closing brace and so before the end.
+ */
+auto parse_tokens(Parser_context& context, Thread_pool& pool) -> bool
+{
+	context.declarations = find_declarations(context.tokens);
+	context.deferred.clear();
+	context.bodies = Bodies::defer;
+	const bool declarations_parsed = parse_tokens(context);
+	context.bodies = Bodies::parse;
+
+	// Bodies are small, so hand them out in contiguous batches.
+	std::vector<Deferred_body>& bodies = context.deferred;
+	const std::size_t batches = std::min(bodies.size(), pool.size() * 8);
+	std::vector<Parser_context> body_contexts(batches);
+	// Where each body's nodes ended up: the batch and the range in its tree.
+	struct Body_nodes
+	{
+		std::size_t batch;
+		std::uint32_t begin;
+		std::uint32_t end;
+	};
+	std::vector<Body_nodes> body_nodes(bodies.size());
+	std::atomic<bool> bodies_parsed{true};
+	pool.parallel_for(batches, [&](std::size_t batch) {
+		Parser_context& body_context = body_contexts[batch];
+		for (std::size_t i = batch * bodies.size() / batches; i < (batch + 1) * bodies.size() / batches && bodies_parsed; ++i)
+		{
+			const std::uint32_t begin = body_context.ast.size();
+			if (!parse_deferred(context, bodies[i], body_context))
+			{
+				bodies_parsed = false;
+			}
+			body_nodes[i] = Body_nodes{batch, begin, body_context.ast.size()};
+		}
+	});
+
+	for (const Parser_context& body_context : body_contexts)
+	{
+		context.visited += body_context.visited;
+	}
 
-	Token_iterator token_begin(begin, end);
-	Token_iterator token_end(end, end);
-	s_token_iter = Iterator(token_begin, token_end, Not_whitespace_or_comment());
-	s_token_end = Iterator(token_end, token_end, Not_whitespace_or_comment());
+	if (!declarations_parsed || !bodies_parsed)
+	{
+		return false;
+	}
 
-	while (s_token_iter != s_token_end && parse_declaration())
+	/*
+	 * Rebuild the tree with each placeholder replaced by its body's nodes,
+	 * moving every later node along and remapping the first index of each
+	 * node from the declaration pass through moved.
+	 */
+	Ast ast;
+	std::vector<std::uint32_t> moved(context.ast.size());
+	std::size_t next = 0;
+	for (std::uint32_t i = 0; i < context.ast.size(); ++i)
 	{
+		moved[i] = ast.size();
+		if (next < bodies.size() && bodies[next].node == i)
+		{
+			const Body_nodes& range = body_nodes[next];
+			const Ast& body_ast = body_contexts[range.batch].ast;
+			for (std::uint32_t j = range.begin; j < range.end; ++j)
+			{
+				const Node& node = body_ast[j];
+				ast.push_back(Node{node.kind, node.token, node.first - range.begin + moved[i]});
+			}
+			bodies[next].node = ast.size() - 1;
+			++next;
+		}
+		else
+		{
+			const Node& node = context.ast[i];
+			ast.push_back(Node{node.kind, node.token, moved[node.first]});
+		}
 	}
+	context.ast = std::move(ast);
 
-	return s_token_iter == s_token_end;
+	return true;
+}
+
+auto parse(Parser_context& context, const char* begin, const char* end, Thread_pool& pool) -> bool
+{
+	context.tokens = Token_buffer(begin, end, Lex_options{Trivia::drop, true, context.atoms}, pool);
+	return parse_tokens(context, pool);
+}
+
+auto parse(Parser_context& context, const Source_file& file, Thread_pool& pool) -> bool
+{
+	context.tokens = Token_buffer(file, Lex_options{Trivia::drop, true, context.atoms}, pool);
+	return parse_tokens(context, pool);
+}
+
+auto parse_interface(Parser_context& context, const char* begin, const char* end) -> bool
+{
+	context.tokens = Token_buffer(begin, end, Lex_options{Trivia::drop, true, context.atoms});
+	context.deferred.clear();
+	context.bodies = Bodies::skip;
+	const bool result = parse_tokens(context);
+	context.bodies = Bodies::parse;
+	return result;
+}
+
+auto parse_deferred(const Parser_context& context, const Deferred_body& body, Parser_context& body_context) -> bool
+{
+	body_context.outer = &context;
+	body_context.watermark = body.watermark;
+	body_context.position = body.begin;
+	body_context.symbols.clear();
+	body_context.memo.clear();
+	limit_stack(body_context);
+	return parse_compound(body_context) && body_context.position == body.end;
+}
+
+auto parse_deferred(const Parser_context& context, const Deferred_body& body) -> bool
+{
+	Parser_context body_context;
+	return parse_deferred(context, body, body_context);
 }
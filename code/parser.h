@@ -1,6 +1,294 @@
 #ifndef EOP_LANG_PARSER_H
 #define EOP_LANG_PARSER_H
 
+#include "ast.h"
+#include "memo.h"
+#include "source_file.h"
+#include "symbol.h"
+#include "token_buffer.h"
+
+#include <cstdint>
+#include <vector>
+
+class Thread_pool;
+
+struct Parse_stats
+{
+	// Significant tokens in the input, each lexed exactly once.
+	std::uint64_t tokens = 0;
+
+	// Parser advances, counting a token again every time backtracking revisits
+	// it.  Lexing on the fly re-lexed a token on each visit after the first, so
+	// tokens_visited - tokens is the number of tokens that lexer re-scanned.
+	std::uint64_t tokens_visited = 0;
+};
+
+// A top-level declaration as delimited by braces and semicolons alone.
+struct Declaration_span
+{
+	std::uint32_t begin;
+	std::uint32_t end;
+
+	// The first brace-enclosed block, or an empty range at end if there is none.
+	std::uint32_t body_begin;
+	std::uint32_t body_end;
+};
+
+// A body skipped by the declaration pass of a parallel or lazy parse.
+struct Deferred_body
+{
+	std::uint32_t begin;
+	std::uint32_t end;
+
+	// Global symbols pushed before the body; only these are visible to it.
+	std::uint32_t watermark;
+
+	// The deferred_body node standing in for it, or once a parallel parse
+	// has spliced the body in, the body's compound node.
+	std::uint32_t node;
+};
+
+enum class Bodies
+{
+	// Parse every body where it appears.
+	parse,
+
+	// Queue procedure bodies at the blocks of the context's declarations.
+	defer,
+
+	// Queue every procedure and member body, finding its end by matching braces.
+	skip,
+};
+
+// The constructs a recovering parse skips when they fail to parse.
+enum class Construct
+{
+	declaration,
+	member,
+	statement,
+};
+
+// A syntax error that a recovering parse skipped past.
+struct Diagnostic
+{
+	Construct construct;
+
+	// Where the parse of the construct stopped, or the number of tokens at the end of the input.
+	std::uint32_t token;
+
+	// The tokens skipped, from the start of the construct to where parsing resumed.
+	std::uint32_t begin;
+	std::uint32_t end;
+
+	// The input ended first, so nothing after the construct was parsed.
+	bool cut_off;
+};
+
+// The rules on the grammar's recursive cycles, as frames of parse_nested.
+enum class Nested : std::uint8_t
+{
+	statement,
+	return_statement,
+	conditional,
+	switch_statement,
+	case_clause,
+	while_statement,
+	do_statement,
+	compound,
+	expression_statement,
+	typedef_declaration,
+	expression,
+	binary,
+	operand,
+	additive_list,
+};
+
+/*
+ * A rule in progress in parse_nested.  The step says where it continues once
+ * the rule it called has returned, and the other fields hold what its
+ * recursive counterpart keeps in locals across that call.
+ */
+struct Nested_frame
+{
+	Nested rule;
+	std::uint8_t step = 0;
+	std::uint8_t power = 0;
+	bool unary = false;
+	std::uint32_t token = 0;
+	std::uint32_t first = 0;
+	std::uint32_t start = 0;
+	std::uint32_t nodes = 0;
+	std::size_t depth = 0;
+};
+
+/*
+ * Receives the declarations and expressions of an event parse as the parser
+ * recognizes them, for tools that need a few facts rather than a tree.
+ * Every hook does nothing unless overridden.  Token indices are into the
+ * tokens passed with them.  Events stop where a parse fails, so a failed
+ * parse may begin a procedure it never ends.  Deeply nested input
+ * continues on a heap stack on the same thread, so every hook runs on the
+ * thread that called parse.
+ */
+class Parse_events
+{
+public:
+	virtual ~Parse_events() = default;
+
+	// After the name of a procedure or operator, before its parameters.
+	virtual auto on_procedure_begin(const Token_buffer& tokens, std::uint32_t name) -> void;
+
+	// After its body, or the ";" of a procedure declared without one.
+	virtual auto on_procedure_end(const Token_buffer& tokens, std::uint32_t name, std::uint32_t parameters) -> void;
+
+	// Once a structure or specialization is known to be one, before its members.
+	virtual auto on_struct(const Token_buffer& tokens, std::uint32_t name) -> void;
+
+	// After the parameters and any constraint of a template, before what it declares.
+	virtual auto on_template_decl(const Token_buffer& tokens, std::uint32_t token) -> void;
+
+	// After every expression, inner ones first, with its tokens [begin, end).
+	// Each kind of member retries the expression a member begins with, so
+	// that one is reported whole, once the member it begins is known.
+	virtual auto on_expression_end(const Token_buffer& tokens, std::uint32_t begin, std::uint32_t end) -> void;
+};
+
+enum class Expressions
+{
+	// One loop over a table of binding powers keyed on the operator token.
+	climbing,
+
+	// A function per precedence level, kept as a reference for the table.
+	descent,
+};
+
+/*
+ * Everything a parse reads and writes.  Contexts share nothing but their
+ * atom table, so separate contexts can parse on separate threads, and
+ * reusing one context for many inputs keeps its tables warm.
+ */
+struct Parser_context
+{
+	Token_buffer tokens;
+	std::uint32_t position = 0;
+
+	// Where lexing interns names, or when null the process-wide pool.
+	Atom_table* atoms = nullptr;
+	std::uint64_t visited = 0;
+	Symbol_table symbols;
+
+	// Rebuilt by every parse; the unit node is last when the parse succeeds.
+	Ast ast;
+
+	Bodies bodies = Bodies::parse;
+	Expressions expressions = Expressions::climbing;
+
+	// The lowest stack address reached at a primary expression, so that
+	// resetting it before a parse measures how deep expressions recurse.
+	std::uintptr_t stack_low = UINTPTR_MAX;
+
+	// Native stack a parse may recurse through before the construct it is in
+	// continues on an explicit stack on the heap.
+	std::size_t stack_budget = 256 * 1024;
+
+	// Set by each parse from stack_budget.
+	std::uintptr_t stack_limit = 0;
+
+	// The frames of the rules in progress on the explicit stack.
+	std::vector<Nested_frame> nested;
+
+	// Set during an event parse, which reports to it instead of building a tree.
+	Parse_events* events = nullptr;
+
+	/*
+	 * Opt-in panic-mode recovery in serial parses: a statement, member or
+	 * declaration that fails is reported and skipped to the next ";", the
+	 * end of a block it opened, or a "}" that closes the enclosing block, or
+	 * at top level to a "struct", "enum" or "template".  The tree holds an
+	 * error node in its place.  Recovery only adds diagnostics: the parse
+	 * passes or fails as it would without it, so input cut off where parse
+	 * accepts it still passes, with its diagnostic.
+	 */
+	bool recover = false;
+	std::vector<Diagnostic> diagnostics;
+
+	// The furthest token where a statement or member has failed since the last diagnostic.
+	std::uint32_t stopped = 0;
+
+	/*
+	 * The statements and members being parsed that reset the position to
+	 * their start when they fail, and whether a parse without recovery would
+	 * have passed, decided at the first diagnostic: only an error at the end
+	 * of the input that no such construct encloses leaves the position there.
+	 */
+	std::uint32_t resetting = 0;
+	bool passes = true;
+
+	// Opt-in packrat memoization of the rules retried after backtracking.
+	bool memoize = false;
+	Memo_table memo;
+
+	std::vector<Declaration_span> declarations;
+	std::vector<Deferred_body> deferred;
+
+	// Set in a context parsing a deferred body, which reads the tokens and
+	// global symbols of the outer context.
+	const Parser_context* outer = nullptr;
+	std::uint32_t watermark = 0;
+};
+
+/*
+ * Splits tokens into top-level declarations: each ends at a ";" outside
+ * braces or at a "}" that closes its outermost block, taking a ";" that
+ * follows.  Stops at the first unbalanced "}"; a trailing declaration whose
+ * braces never close has no body.
+ */
+auto find_declarations(const Token_buffer& tokens) -> std::vector<Declaration_span>;
+
 auto parse(const char* begin, const char* end) -> bool;
+auto parse(const char* begin, const char* end, Parse_stats& stats) -> bool;
+auto parse(Parser_context& context, const char* begin, const char* end) -> bool;
+
+// Lexes straight from the file's contents; the context keeps them alive.
+auto parse(Parser_context& context, const Source_file& file) -> bool;
+
+/*
+ * Event parsing: parses the tokens already in context.tokens, every body
+ * where it appears, reporting to events and leaving context.ast empty.
+ * Allocates nothing once the context's tables have grown to the input.
+ */
+auto parse(Parser_context& context, Parse_events& events) -> bool;
+auto parse(Parser_context& context, const char* begin, const char* end, Parse_events& events) -> bool;
+
+/*
+ * Parses further top-level declarations of the input the context has been
+ * parsing, so the global symbols of those before stay visible while the
+ * tokens and tree hold only the new ones.  Declares them in the innermost
+ * open scope, so a caller can scope the globals of some declarations to
+ * drop them later.  Stricter than parse: a declaration cut off at end is a
+ * failure, which leaves the position where it stopped and may leave the
+ * scopes of its blocks open for the caller to pop.
+ */
+auto parse_more(Parser_context& context, const char* begin, const char* end) -> bool;
+
+/*
+ * Lexes on the pool, parses the declarations in order with procedure bodies
+ * skipped, then parses the bodies on the pool.  Each body sees the global
+ * symbols declared before it, so the result is that of a serial parse.
+ */
+auto parse(Parser_context& context, const char* begin, const char* end, Thread_pool& pool) -> bool;
+auto parse(Parser_context& context, const Source_file& file, Thread_pool& pool) -> bool;
+
+/*
+ * Lazy parsing: parses only the declarations, skipping the bodies of
+ * procedures, constructors, destructors and operators and listing them in
+ * context.deferred.  The input parses if this and every deferred body do.
+ */
+auto parse_interface(Parser_context& context, const char* begin, const char* end) -> bool;
+
+// Parses one body listed by the outer context, reusing body_context's tables
+// and appending the body's nodes to body_context.ast.
+auto parse_deferred(const Parser_context& context, const Deferred_body& body, Parser_context& body_context) -> bool;
+auto parse_deferred(const Parser_context& context, const Deferred_body& body) -> bool;
 
 #endif
@@ -1,7 +1,72 @@
+#include "allocations.h"
+#include "corpus.h"
 #include "parser.h"
+#include "thread_pool.h"
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Records every event with the text of the tokens it names.
+	class Event_log : public Parse_events
+	{
+	public:
+		std::vector<std::string> events;
+
+		auto on_procedure_begin(const Token_buffer& tokens, std::uint32_t name) -> void override
+		{
+			events.push_back("procedure " + text(tokens, name, name + 1));
+		}
+
+		auto on_procedure_end(const Token_buffer& tokens, std::uint32_t name, std::uint32_t parameters) -> void override
+		{
+			events.push_back("end " + text(tokens, name, name + 1) + " " + std::to_string(parameters));
+		}
+
+		auto on_struct(const Token_buffer& tokens, std::uint32_t name) -> void override
+		{
+			events.push_back("struct " + text(tokens, name, name + 1));
+		}
+
+		auto on_template_decl(const Token_buffer& tokens, std::uint32_t token) -> void override
+		{
+			events.push_back(text(tokens, token, token + 1));
+		}
+
+		auto on_expression_end(const Token_buffer& tokens, std::uint32_t begin, std::uint32_t end) -> void override
+		{
+			events.push_back("expression " + text(tokens, begin, end));
+		}
+
+	private:
+		static auto text(const Token_buffer& tokens, std::uint32_t begin, std::uint32_t end) -> std::string
+		{
+			return std::string(tokens.token(begin).begin, tokens.token(end - 1).end);
+		}
+	};
+
+	// Counts procedures and their parameters, as a tool that needs no more would.
+	class Procedure_count : public Parse_events
+	{
+	public:
+		std::uint32_t procedures = 0;
+		std::uint32_t parameters = 0;
+
+		auto on_procedure_end(const Token_buffer&, std::uint32_t, std::uint32_t count) -> void override
+		{
+			++procedures;
+			parameters += count;
+		}
+	};
+}
+
 TEST_CASE("Parse empty input", "[parser]")
 {
 	const char input[] = "";
@@ -126,3 +191,854 @@ TEST_CASE("Parse scoping", "[parser]")
 	const char* input_end = input + sizeof(input) - 1;
 	REQUIRE(!parse(input, input_end));
 }
+
+TEST_CASE("Count tokens revisited by backtracking", "[parser]")
+{
+	const char input[] =
+		"int main()"
+		"{"
+		"x = y;"
+		"}";
+	const char* input_end = input + sizeof(input) - 1;
+
+	Parse_stats stats;
+	REQUIRE(parse(input, input_end, stats));
+	REQUIRE(stats.tokens == 10);
+	REQUIRE(stats.tokens_visited == 10);
+}
+
+TEST_CASE("Parse statements without backtracking", "[parser][ast]")
+{
+	const char input[] =
+		"int main(int y)"
+		"{"
+		"start:"
+		"f(y);"
+		"x = y + 1;"
+		"int z;"
+		"int a(1, y);"
+		"int& b = a;"
+		"typedef int T;"
+		"if (a < b) { return a; } else return b;"
+		"while (a) a = a - 1;"
+		"do { break; } while (b);"
+		"switch (y) { }"
+		"goto start;"
+		"}";
+	const char* input_end = input + sizeof(input) - 1;
+
+	Parse_stats stats;
+	REQUIRE(parse(input, input_end, stats));
+	REQUIRE(stats.tokens_visited == stats.tokens);
+
+	Parser_context context;
+	REQUIRE(parse(context, input, input_end));
+	REQUIRE(context.ast[context.ast.size() - 2].kind == Node_kind::procedure);
+	const std::vector<std::uint32_t> parts = context.ast.children(context.ast.size() - 2);
+	REQUIRE(to_string(context.ast, context.tokens, parts.back()) ==
+		"(compound { (label start) (expression_statement f (call ( (name f) (name y)))"
+		" (assignment = (name x) (binary + (name y) (literal 1)))"
+		" (construction z (basic_type int)) (construction a (basic_type int) (literal 1) (name y))"
+		" (construction b (address & (basic_type int)) (name a)) (typedef T (basic_type int))"
+		" (conditional if (binary < (name a) (name b)) (compound { (return return (name a))) (return return (name b)))"
+		" (while while (name a) (assignment = (name a) (binary - (name a) (literal 1))))"
+		" (do do (compound { (break break)) (name b)) (switch switch (name y)) (goto start))");
+}
+
+TEST_CASE("Reject a statement cut off after its expression", "[parser]")
+{
+	const std::vector<std::string> inputs = {
+		"int main() { x = y }",
+		"int main() { x y z; }",
+		"int main() { int a(; }",
+		"int main() { int a = ; }",
+		"int main() { x = y +",
+	};
+	for (const std::string& input : inputs)
+	{
+		CAPTURE(input);
+		REQUIRE(!parse(input.data(), input.data() + input.size()));
+	}
+}
+
+TEST_CASE("Reject input past 32-bit offsets", "[parser]")
+{
+	// Neither parse reads the range, so it need not be backed by memory.
+	const char* begin = reinterpret_cast<const char*>(std::uintptr_t(1) << 40);
+	const char* end = begin + (std::uint64_t(1) << 32);
+
+	Parser_context context;
+	const std::string input = "int f();";
+	REQUIRE(parse(context, input.data(), input.data() + input.size()));
+	REQUIRE(!parse(context, begin, end));
+	REQUIRE(context.tokens.too_large());
+	REQUIRE(context.ast.empty());
+
+	Thread_pool pool(2);
+	REQUIRE(!parse(context, begin, end, pool));
+	REQUIRE(context.ast.empty());
+}
+
+TEST_CASE("Parse goto statement", "[parser][ast]")
+{
+	const std::string input = "void f() { goto x; x: return; }";
+
+	Parser_context context;
+	REQUIRE(parse(context, input.data(), input.data() + input.size()));
+	REQUIRE(to_string(context.ast, context.tokens, context.ast.size() - 1) ==
+		"(unit (procedure f (basic_type void) (compound { (goto x) (label x) (return return))))");
+
+	const std::vector<std::string> rejected = {
+		"void f() { goto; }",
+		"void f() { goto x }",
+		"void f() { goto x y; }",
+	};
+	for (const std::string& bad : rejected)
+	{
+		CAPTURE(bad);
+		REQUIRE(!parse(bad.data(), bad.data() + bad.size()));
+	}
+}
+
+TEST_CASE("Parse keyword as member name", "[parser]")
+{
+	const char input[] =
+		"struct wrapper"
+		"{"
+		"T int;"
+		"T operator;"
+		"};";
+	const char* input_end = input + sizeof(input) - 1;
+	REQUIRE(parse(input, input_end));
+}
+
+TEST_CASE("Parse keyword as expression", "[parser]")
+{
+	const char input[] =
+		"int main()"
+		"{"
+		"x = while;"
+		"}";
+	const char* input_end = input + sizeof(input) - 1;
+	REQUIRE(!parse(input, input_end));
+}
+
+TEST_CASE("Parse many inputs concurrently", "[parser][concurrency]")
+{
+	struct Input
+	{
+		std::string text;
+		bool valid;
+	};
+
+	std::vector<Input> inputs = {
+		{"", true},
+		{"bool operator==(const T& x, const T& y);", true},
+		{"struct singleton { pointer(int) p_int; ~singleton() { free(p_int); } };", true},
+		{"int main() { typedef pair Type; Type<int, int> foo; }", true},
+		{"int main() { typedef Pair type; } int fun() { type<int, int> foo; }", false},
+		{"int main() { x = while; }", false},
+	};
+	for (std::size_t size = 256; size <= 16 * 1024; size *= 4)
+	{
+		inputs.push_back({generate_corpus(size), true});
+	}
+
+	const unsigned thread_count = std::max(4u, std::thread::hardware_concurrency());
+	const int rounds = 2000 / static_cast<int>(inputs.size()) + 1;
+	std::atomic<int> failures{0};
+	std::atomic<int> parsed{0};
+
+	std::vector<std::thread> threads;
+	for (unsigned t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([&, t] {
+			// Half the threads reuse one context, the rest make a new one per input.
+			Parser_context shared;
+			for (int round = 0; round < rounds; ++round)
+			{
+				for (std::size_t i = 0; i < inputs.size(); ++i)
+				{
+					const Input& input = inputs[(i + t) % inputs.size()];
+					const char* begin = input.text.data();
+					const char* end = begin + input.text.size();
+					const bool result = t % 2 ? parse(shared, begin, end) : parse(begin, end);
+					if (result != input.valid)
+					{
+						++failures;
+					}
+					++parsed;
+				}
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	REQUIRE(failures == 0);
+	REQUIRE(parsed >= 2000 * static_cast<int>(thread_count));
+}
+
+TEST_CASE("Find declaration boundaries", "[parser]")
+{
+	const char input[] =
+		"enum e { a, b };"
+		"int f() { if (x) { y; } }"
+		"int g();"
+		"struct s { s() { } };"
+		"int h() { ";
+	const char* input_end = input + sizeof(input) - 1;
+
+	const Token_buffer tokens(input, input_end);
+	const std::vector<Declaration_span> declarations = find_declarations(tokens);
+	REQUIRE(declarations.size() == 5);
+
+	REQUIRE(declarations[0].begin == 0);
+	REQUIRE(declarations[0].end == 8);
+	REQUIRE(declarations[0].body_begin == 2);
+	REQUIRE(declarations[0].body_end == 7);
+
+	REQUIRE(declarations[1].begin == 8);
+	REQUIRE(declarations[1].end == 22);
+	REQUIRE(declarations[1].body_begin == 12);
+	REQUIRE(declarations[1].body_end == 22);
+
+	REQUIRE(declarations[2].end == 27);
+	REQUIRE(declarations[2].body_begin == declarations[2].body_end);
+
+	REQUIRE(declarations[3].body_begin == 29);
+	REQUIRE(declarations[3].end == 37);
+
+	// The last body never closes, so it is not treated as one.
+	REQUIRE(declarations[4].end == tokens.size());
+	REQUIRE(declarations[4].body_begin == declarations[4].body_end);
+}
+
+TEST_CASE("Parse bodies in parallel", "[parser]")
+{
+	const std::string inputs[] = {
+		"",
+		"void g(); int f() { g<int>; }",
+		"int f() { g<int>; } void g();",
+		"struct p; int f() { p<int> x; typedef int t; t<int>; }",
+		"int f() { typedef int t; } int g() { t<int>; }",
+		"struct s { s() { typedef int t; } }; int f() { t<int>; }",
+		"int f() { return 0; } }",
+		"int f() { return 0; } int g() {",
+		"int main() { x = while; }",
+		generate_corpus(64 * 1024),
+	};
+
+	Thread_pool pool(3);
+	Parser_context context;
+	for (const std::string& input : inputs)
+	{
+		const char* begin = input.data();
+		const char* end = begin + input.size();
+		INFO(input.substr(0, 80));
+		REQUIRE(parse(context, begin, end, pool) == parse(begin, end));
+	}
+	REQUIRE(!context.deferred.empty());
+}
+
+TEST_CASE("Parse bodies lazily", "[parser]")
+{
+	const std::string inputs[] = {
+		"",
+		"int f() { g<int>; } void g();",
+		"void g(); int f() { g<int>; }",
+		"struct pair { pair() { first<int>; } ~pair() { } void operator=(pair x) { } int operator()() { } int operator[](int i) { } int first; };",
+		"struct s { s() { typedef int t; } }; int f() { t<int>; }",
+		"template<typename T> struct s { s() { } } template<typename T> int f() { return 0; }",
+		"int main() { x = while; }",
+		"int f() { return 0; } int g() {",
+		generate_corpus(16 * 1024),
+	};
+
+	Parser_context context;
+	Parser_context body_context;
+	for (const std::string& input : inputs)
+	{
+		const char* begin = input.data();
+		const char* end = begin + input.size();
+		INFO(input.substr(0, 80));
+
+		bool result = parse_interface(context, begin, end);
+		for (const Deferred_body& body : context.deferred)
+		{
+			REQUIRE(context.tokens.kind(body.begin) == Token_kind::open_brace);
+			REQUIRE(context.tokens.kind(body.end - 1) == Token_kind::close_brace);
+			result = parse_deferred(context, body, body_context) && result;
+		}
+		REQUIRE(result == parse(begin, end));
+	}
+}
+
+TEST_CASE("Skip every kind of body", "[parser]")
+{
+	const char input[] =
+		"struct pair"
+		"{"
+		"pair() { }"
+		"~pair() { }"
+		"void operator=(pair x) { }"
+		"int operator()() { }"
+		"int operator[](int i) { }"
+		"};"
+		"int main() { { } }";
+	const char* input_end = input + sizeof(input) - 1;
+
+	Parser_context context;
+	REQUIRE(parse_interface(context, input, input_end));
+	REQUIRE(context.deferred.size() == 6);
+	REQUIRE(context.deferred.back().end == context.tokens.size());
+	REQUIRE(context.deferred.back().end - context.deferred.back().begin == 4);
+}
+
+TEST_CASE("Build syntax tree", "[parser][ast]")
+{
+	const char input[] =
+		"int main()"
+		"{"
+		"x = y + 1 * 2 - 3;"
+		"return f(a, b.c)[0] && !d || e;"
+		"}";
+	const char* input_end = input + sizeof(input) - 1;
+
+	Parser_context context;
+	REQUIRE(parse(context, input, input_end));
+	REQUIRE(context.ast[context.ast.size() - 1].kind == Node_kind::unit);
+	REQUIRE(to_string(context.ast, context.tokens, context.ast.size() - 1) ==
+		"(unit (procedure main (basic_type int) (compound {"
+		" (assignment = (name x) (binary - (binary + (name y) (binary * (literal 1) (literal 2))) (literal 3)))"
+		" (return return (binary && (subscript [ (call ( (name f) (name a) (member c (name b))) (literal 0))"
+		" (binary || (prefix ! (name d)) (name e)))))))");
+}
+
+TEST_CASE("Build declaration tree", "[parser][ast]")
+{
+	const char input[] =
+		"template<typename T> requires(Regular(T))"
+		"struct pair"
+		"{"
+		"T first;"
+		"pair(T x) : first(x) { }"
+		"~pair() { }"
+		"};"
+		"enum color { red, green };"
+		"int f(";
+	const char* input_end = input + sizeof(input) - 1;
+
+	// The cut-off declaration at the end is accepted but leaves no nodes.
+	Parser_context context;
+	REQUIRE(parse(context, input, input_end));
+	REQUIRE(to_string(context.ast, context.tokens, context.ast.size() - 1) ==
+		"(unit (template template (parameter T (basic_type typename))"
+		" (constraint requires (call ( (name Regular) (name T)))"
+		" (structure pair (data_member first (name T))"
+		" (constructor pair (parameter x (name T)) (initializer first (name x)) (compound {))"
+		" (destructor pair (compound {))))"
+		" (enumeration color (enumerator red) (enumerator green)))");
+}
+
+TEST_CASE("Backtracking discards nodes", "[parser][ast]")
+{
+	const char input[] =
+		"struct pair;"
+		"int main()"
+		"{"
+		"typedef pair P;"
+		"P<int> z;"
+		"l: do { } while (1);"
+		"}";
+	const char* input_end = input + sizeof(input) - 1;
+
+	Parser_context context;
+	REQUIRE(parse(context, input, input_end));
+	REQUIRE(to_string(context.ast, context.tokens, context.ast.size() - 1) ==
+		"(unit (structure pair) (procedure main (basic_type int) (compound {"
+		" (typedef P (name pair))"
+		" (construction z (template_instance P (basic_type int)))"
+		" (label l)"
+		" (do do (compound {) (literal 1)))))");
+}
+
+TEST_CASE("Parallel and lazy parses build the same tree", "[parser][ast]")
+{
+	const std::string input = generate_corpus(64 * 1024);
+	const char* begin = input.data();
+	const char* end = begin + input.size();
+
+	Parser_context serial;
+	REQUIRE(parse(serial, begin, end));
+
+	Thread_pool pool(3);
+	Parser_context parallel;
+	REQUIRE(parse(parallel, begin, end, pool));
+	REQUIRE(parallel.ast.size() == serial.ast.size());
+	for (std::uint32_t i = 0; i < serial.ast.size(); ++i)
+	{
+		REQUIRE(parallel.ast[i].kind == serial.ast[i].kind);
+		REQUIRE(parallel.ast[i].token == serial.ast[i].token);
+		REQUIRE(parallel.ast[i].first == serial.ast[i].first);
+	}
+	REQUIRE(parallel.ast[parallel.deferred.front().node].kind == Node_kind::compound);
+
+	Parser_context lazy;
+	REQUIRE(parse_interface(lazy, begin, end));
+	Parser_context body_context;
+	for (const Deferred_body& body : lazy.deferred)
+	{
+		REQUIRE(lazy.ast[body.node].kind == Node_kind::deferred_body);
+		REQUIRE(lazy.ast[body.node].token == body.begin);
+
+		body_context.ast.clear();
+		REQUIRE(parse_deferred(lazy, body, body_context));
+		const Node& root = body_context.ast[body_context.ast.size() - 1];
+		REQUIRE(root.kind == Node_kind::compound);
+		REQUIRE(root.first == 0);
+	}
+}
+
+TEST_CASE("Expression engines agree", "[parser][ast]")
+{
+	std::vector<std::string> inputs = {
+		"int f() { return a || b && c || d; }",
+		"int f() { return a && b == c && d < e; }",
+		"int f() { return a - b - c * d / e % -f; }",
+		"int f() { return a < b <= c > d >= e == f != g; }",
+		"int f() { return (a + b) * !c.d(e, f)[g] & || h; }",
+		"template <typename T> struct s { }; int f() { s<a + b, c * d> x; x = s<a < b>; }",
+		"int f() { return a + ; }",
+		"int f() { return a && ; }",
+		"int f() { return a * (b + c; }",
+		"int f() { x = a b; }",
+		"int f() { return a +",
+		generate_corpus(16 * 1024),
+	};
+
+	for (const std::string& input : inputs)
+	{
+		CAPTURE(input);
+		const char* begin = input.data();
+		const char* end = begin + input.size();
+
+		Parser_context climbing;
+		Parser_context descent;
+		descent.expressions = Expressions::descent;
+		REQUIRE(parse(climbing, begin, end) == parse(descent, begin, end));
+		REQUIRE(climbing.position == descent.position);
+		REQUIRE(climbing.visited == descent.visited);
+		REQUIRE(climbing.ast.size() == descent.ast.size());
+		for (std::uint32_t i = 0; i < climbing.ast.size(); ++i)
+		{
+			REQUIRE(climbing.ast[i].kind == descent.ast[i].kind);
+			REQUIRE(climbing.ast[i].token == descent.ast[i].token);
+			REQUIRE(climbing.ast[i].first == descent.ast[i].first);
+		}
+	}
+}
+
+TEST_CASE("Precedence climbing recurses less", "[parser]")
+{
+	const std::string input = "int f() { return " + std::string(100, '(') + "x" + std::string(100, ')') + "; }";
+	const char* begin = input.data();
+	const char* end = begin + input.size();
+
+	const char base = 0;
+	Parser_context climbing;
+	REQUIRE(parse(climbing, begin, end));
+	Parser_context descent;
+	descent.expressions = Expressions::descent;
+	REQUIRE(parse(descent, begin, end));
+	REQUIRE(reinterpret_cast<std::uintptr_t>(&base) - climbing.stack_low < reinterpret_cast<std::uintptr_t>(&base) - descent.stack_low);
+}
+
+TEST_CASE("Memoization replays member expressions", "[parser][ast]")
+{
+	const char input[] =
+		"struct vector"
+		"{"
+		"int size;"
+		"int data[16];"
+		"int operator[](int i) { return data[i]; }"
+		"int operator()() { return size; }"
+		"};"
+		"int main() { }";
+	const char* input_end = input + sizeof(input) - 1;
+
+	Parser_context plain;
+	REQUIRE(parse(plain, input, input_end));
+
+	Parser_context memoized;
+	memoized.memoize = true;
+	REQUIRE(parse(memoized, input, input_end));
+	REQUIRE(memoized.memo.size() > 0);
+
+	// Without memoization "int" in the index operator is parsed three times and in the apply operator twice.
+	REQUIRE(plain.visited == memoized.visited + 3);
+	REQUIRE(to_string(memoized.ast, memoized.tokens, memoized.ast.size() - 1) == to_string(plain.ast, plain.tokens, plain.ast.size() - 1));
+}
+
+TEST_CASE("Parse deeply nested input", "[parser]")
+{
+	const int depth = 100000;
+	std::string statements = "int f(int x) { ";
+	for (int i = 0; i < depth; ++i)
+	{
+		statements += "if (x) { ";
+	}
+	statements += "x = 1;" + std::string(depth, '}') + " }";
+
+	const std::string parentheses = "int f(int x) { return " + std::string(depth, '(') + "x" + std::string(depth, ')') + "; }";
+
+	std::string conjunction = "int f(int x) { return x";
+	for (int i = 0; i < depth; ++i)
+	{
+		conjunction += " && x";
+	}
+	conjunction += "; }";
+
+	std::string arguments = "template <typename T> struct s; int f(int x) { return ";
+	for (int i = 0; i < depth; ++i)
+	{
+		arguments += "s<";
+	}
+	arguments += "x" + std::string(depth, '>') + "; }";
+
+	const auto count = [](const Ast& ast, Node_kind kind)
+	{
+		int n = 0;
+		for (std::uint32_t i = 0; i < ast.size(); ++i)
+		{
+			n += ast[i].kind == kind;
+		}
+		return n;
+	};
+
+	for (const Expressions expressions : {Expressions::climbing, Expressions::descent})
+	{
+		Parser_context context;
+		context.expressions = expressions;
+		REQUIRE(parse(context, statements.data(), statements.data() + statements.size()));
+		REQUIRE(count(context.ast, Node_kind::conditional) == depth);
+		REQUIRE(parse(context, parentheses.data(), parentheses.data() + parentheses.size()));
+		REQUIRE(parse(context, conjunction.data(), conjunction.data() + conjunction.size()));
+		REQUIRE(count(context.ast, Node_kind::binary) == depth);
+		REQUIRE(parse(context, arguments.data(), arguments.data() + arguments.size()));
+
+		// Cut off at the deepest point, as when the nesting never closes.
+		REQUIRE(!parse(context, parentheses.data(), parentheses.data() + depth + 10));
+	}
+}
+
+TEST_CASE("Explicit stack parses as recursion does", "[parser][ast]")
+{
+	const std::vector<std::string> inputs = {
+		"int f() { return a || b && c || d; }",
+		"int f() { return (a + b) * !c.d(e, f)[g] & || h; }",
+		"int f() { return -x.y() + g(); }",
+		"template <typename T> struct s { }; int f() { s<a + b, c * d> x; x = s<a < b>; }",
+		"int f() { int a(1, b); int c = 2; int d; a = c; g(); }",
+		"int f() { typedef int t; t x; }",
+		"int f() { if (a) b = 1; else { c = 2; } while (d) { } do e(); while (f); }",
+		"int f() { switch (x) { case 1: y = 2; break; case 2: { } } }",
+		"int f() { start: goto start; }",
+		"int f() { return a + ; }",
+		"int f() { return a * (b + c; }",
+		"int f() { x = a b; }",
+		"int f() { int a(1, ; }",
+		"int f() { typedef int; }",
+		"int f() { if (x) { y = ; z = 1; } w = 2 }",
+		"int f() { while (x) { switch (y) { case 1: = ; } } }",
+		"int f() { do { } while (x) }",
+		"int f() { return a +",
+		generate_corpus(16 * 1024),
+	};
+
+	for (const std::string& input : inputs)
+	{
+		for (const Expressions expressions : {Expressions::climbing, Expressions::descent})
+		{
+			for (const bool recover : {false, true})
+			{
+				CAPTURE(input, recover);
+				const char* begin = input.data();
+				const char* end = begin + input.size();
+
+				Parser_context recursive;
+				recursive.expressions = expressions;
+				recursive.recover = recover;
+				Parser_context explicit_stack;
+				explicit_stack.expressions = expressions;
+				explicit_stack.recover = recover;
+				explicit_stack.stack_budget = 0;
+				REQUIRE(parse(recursive, begin, end) == parse(explicit_stack, begin, end));
+				REQUIRE(recursive.position == explicit_stack.position);
+				REQUIRE(recursive.visited == explicit_stack.visited);
+				REQUIRE(recursive.ast.size() == explicit_stack.ast.size());
+				for (std::uint32_t i = 0; i < recursive.ast.size(); ++i)
+				{
+					REQUIRE(recursive.ast[i].kind == explicit_stack.ast[i].kind);
+					REQUIRE(recursive.ast[i].token == explicit_stack.ast[i].token);
+					REQUIRE(recursive.ast[i].first == explicit_stack.ast[i].first);
+				}
+				REQUIRE(recursive.diagnostics.size() == explicit_stack.diagnostics.size());
+				for (std::size_t i = 0; i < recursive.diagnostics.size(); ++i)
+				{
+					REQUIRE(recursive.diagnostics[i].token == explicit_stack.diagnostics[i].token);
+					REQUIRE(recursive.diagnostics[i].begin == explicit_stack.diagnostics[i].begin);
+					REQUIRE(recursive.diagnostics[i].end == explicit_stack.diagnostics[i].end);
+				}
+
+				Event_log recursive_log;
+				Event_log explicit_log;
+				REQUIRE(parse(recursive, begin, end, recursive_log) == parse(explicit_stack, begin, end, explicit_log));
+				REQUIRE(recursive_log.events == explicit_log.events);
+			}
+		}
+	}
+}
+
+TEST_CASE("Report parse events", "[parser][events]")
+{
+	const char input[] =
+		"template <typename T> requires(Regular(T))\n"
+		"struct box { T value; T items[4]; T operator()() { return value + 1; } T operator[](int i) { return items[i]; } };\n"
+		"template <typename T> struct box<int>;\n"
+		"int sum(box b, int n) { return f(n * 2) + n; }\n"
+		"void g();";
+	const char* input_end = input + sizeof(input) - 1;
+
+	Parser_context context;
+	context.bodies = Bodies::defer;
+	Event_log log;
+	REQUIRE(parse(context, input, input_end, log));
+	REQUIRE(context.ast.empty());
+	REQUIRE(context.bodies == Bodies::defer);
+	REQUIRE(context.events == nullptr);
+	REQUIRE(log.events == std::vector<std::string>{
+		"expression typename", "expression T", "expression Regular(T)", "template",
+		"struct box", "expression T", "expression 4", "expression T",
+		"expression T", "expression value + 1",
+		"expression T", "expression int", "expression i", "expression items[i]",
+		"expression typename", "template", "struct box",
+		"expression int", "procedure sum", "expression box", "expression int", "expression n * 2", "expression f(n * 2) + n", "end sum 2",
+		"procedure g", "end g 0",
+	});
+}
+
+TEST_CASE("Event parse allocates nothing", "[parser][events]")
+{
+	const std::string input = generate_corpus(64 * 1024);
+
+	Parser_context context;
+	context.tokens = Token_buffer(input.data(), input.data() + input.size(), Lex_options{Trivia::drop, true});
+	Procedure_count warm;
+	REQUIRE(parse(context, warm));
+
+	Procedure_count count;
+	start_counting_allocations();
+	const bool parsed = parse(context, count);
+	const std::size_t allocations = stop_counting_allocations();
+
+	REQUIRE(parsed);
+	REQUIRE(allocations == 0);
+	REQUIRE(count.procedures == warm.procedures);
+	REQUIRE(count.procedures > 0);
+
+	// The events describe the procedures of the tree a plain parse builds.
+	Parser_context tree;
+	REQUIRE(parse(tree, input.data(), input.data() + input.size()));
+	std::uint32_t procedures = 0;
+	for (std::uint32_t i = 0; i < tree.ast.size(); ++i)
+	{
+		procedures += tree.ast[i].kind == Node_kind::procedure;
+	}
+	REQUIRE(count.procedures == procedures);
+}
+
+TEST_CASE("Deeply nested event parse allocates nothing", "[parser][events]")
+{
+	// Each procedure continues on the explicit stack, which the context keeps between them.
+	std::string input;
+	for (int n = 0; n < 4; ++n)
+	{
+		input += "int f" + std::to_string(n) + "(int x) { ";
+		for (int i = 0; i < 10000; ++i)
+		{
+			input += "if (x) { ";
+		}
+		input += "return " + std::string(10000, '(') + "x" + std::string(10000, ')') + ";" + std::string(10000, '}') + " }\n";
+	}
+
+	Parser_context context;
+	context.tokens = Token_buffer(input.data(), input.data() + input.size(), Lex_options{Trivia::drop, true});
+	Procedure_count warm;
+	REQUIRE(parse(context, warm));
+	REQUIRE(context.nested.capacity() > 0);
+
+	for (int repeat = 0; repeat < 2; ++repeat)
+	{
+		Procedure_count count;
+		start_counting_allocations();
+		const bool parsed = parse(context, count);
+		const std::size_t allocations = stop_counting_allocations();
+
+		REQUIRE(parsed);
+		REQUIRE(allocations == 0);
+		REQUIRE(count.procedures == 4);
+	}
+}
+
+TEST_CASE("Recover from syntax errors", "[parser][recovery]")
+{
+	const char input[] =
+		"int f() { x = 1; y = ; z = 2; }"
+		"struct s { int a; b c d; int e; };"
+		"int g( { }"
+		"} int h() { return 1; }";
+	const char* input_end = input + sizeof(input) - 1;
+
+	Parser_context context;
+	context.recover = true;
+	REQUIRE(!parse(context, input, input_end));
+	REQUIRE(context.diagnostics.size() == 4);
+
+	const auto text = [&context](std::uint32_t index) {
+		const Token token = context.tokens.token(index);
+		return std::string(token.begin, token.end);
+	};
+	REQUIRE(context.diagnostics[0].construct == Construct::statement);
+	REQUIRE(text(context.diagnostics[0].token) == ";");
+	REQUIRE(context.diagnostics[1].construct == Construct::member);
+	REQUIRE(text(context.diagnostics[1].token) == "d");
+	REQUIRE(context.diagnostics[2].construct == Construct::declaration);
+	REQUIRE(text(context.diagnostics[2].token) == "{");
+	REQUIRE(context.diagnostics[3].construct == Construct::declaration);
+	REQUIRE(text(context.diagnostics[3].token) == "}");
+	for (const Diagnostic& diagnostic : context.diagnostics)
+	{
+		REQUIRE(!diagnostic.cut_off);
+		REQUIRE(diagnostic.begin <= diagnostic.token);
+		REQUIRE(diagnostic.token < diagnostic.end);
+	}
+
+	REQUIRE(to_string(context.ast, context.tokens, context.ast.size() - 1) ==
+		"(unit (procedure f (basic_type int) (compound {"
+		" (assignment = (name x) (literal 1)) (error y) (assignment = (name z) (literal 2))))"
+		" (structure s (data_member a (basic_type int)) (error b) (data_member e (basic_type int)))"
+		" (error int) (error })"
+		" (procedure h (basic_type int) (compound { (return return (literal 1)))))");
+}
+
+TEST_CASE("Report input cut off once", "[parser][recovery]")
+{
+	const std::vector<std::string> inputs = {
+		"int f() { x = 1;",
+		"int f() { if (x) { struct s { int a;",
+		"struct s { int a;",
+		"int f(",
+	};
+
+	for (const std::string& input : inputs)
+	{
+		CAPTURE(input);
+		Parser_context context;
+		context.recover = true;
+		REQUIRE(parse(context, input.data(), input.data() + input.size()) == parse(input.data(), input.data() + input.size()));
+		REQUIRE(context.diagnostics.size() == 1);
+		REQUIRE(context.diagnostics[0].cut_off);
+		REQUIRE(context.diagnostics[0].end == context.tokens.size());
+	}
+}
+
+TEST_CASE("Recovery passes and fails as parse does", "[parser][recovery]")
+{
+	// Tails cut off at every kind of point, after a valid prefix and alone.
+	const std::vector<std::string> tails = {
+		"void f() {",
+		"void f() { x = 1;",
+		"void f() { x = 1",
+		"void f() { if (x) {",
+		"void f() { while (x) { y = 2;",
+		"struct s {",
+		"struct s { int a;",
+		"struct s { s() {",
+		"struct s { int operator()(int x) {",
+		"struct s { int operator()(int x) { return x;",
+		"int f(",
+		"template <typename T> struct",
+		"enum color { red,",
+		"void f() { x = ; } void g() {",
+	};
+	const std::string prefix = generate_corpus(16 * 1024);
+	Thread_pool pool(2);
+
+	for (const std::string& tail : tails)
+	{
+		for (const std::string& input : {tail, prefix + tail})
+		{
+			CAPTURE(tail);
+			const char* begin = input.data();
+			const char* end = begin + input.size();
+
+			Parser_context plain;
+			const bool passed = parse(plain, begin, end);
+
+			Parser_context parallel;
+			REQUIRE(parse(parallel, begin, end, pool) == passed);
+
+			Parser_context recovering;
+			recovering.recover = true;
+			REQUIRE(parse(recovering, begin, end) == passed);
+			REQUIRE(!recovering.diagnostics.empty());
+		}
+	}
+}
+
+TEST_CASE("Recovery leaves valid input unchanged", "[parser][recovery]")
+{
+	const std::string input = generate_corpus(64 * 1024);
+
+	Parser_context plain;
+	REQUIRE(parse(plain, input.data(), input.data() + input.size()));
+
+	Parser_context recovering;
+	recovering.recover = true;
+	REQUIRE(parse(recovering, input.data(), input.data() + input.size()));
+	REQUIRE(recovering.diagnostics.empty());
+	REQUIRE(to_string(recovering.ast, recovering.tokens, recovering.ast.size() - 1) ==
+		to_string(plain.ast, plain.tokens, plain.ast.size() - 1));
+}
+
+TEST_CASE("Recover from many errors in one pass", "[parser][recovery]")
+{
+	// Break a statement in every procedure and a member in every structure.
+	std::string input = generate_corpus(256 * 1024);
+	std::size_t broken = 0;
+	for (std::size_t i = input.find(" = "); i != std::string::npos; i = input.find(" = ", i + 3))
+	{
+		input.replace(i, 3, " = = ");
+		++broken;
+	}
+	REQUIRE(broken > 100);
+
+	Parser_context context;
+	context.recover = true;
+	REQUIRE(!parse(context, input.data(), input.data() + input.size()));
+	REQUIRE(context.diagnostics.size() == broken);
+	for (std::size_t i = 1; i < context.diagnostics.size(); ++i)
+	{
+		REQUIRE(context.diagnostics[i - 1].end <= context.diagnostics[i].begin);
+	}
+
+	// Skipping to a boundary rescans no more than a pass over the tokens.
+	Parser_context valid;
+	const std::string original = generate_corpus(256 * 1024);
+	REQUIRE(parse(valid, original.data(), original.data() + original.size()));
+	REQUIRE(context.visited <= 2 * valid.visited);
+}
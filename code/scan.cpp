@@ -0,0 +1,480 @@
+#include "scan.h"
+
+#include <array>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define EOP_SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define EOP_SCAN_X86 0
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define EOP_TARGET_AVX2
+#else
+#define EOP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace
+{
+	enum Char_class : std::uint8_t
+	{
+		letter = 1 << 0,
+		digit = 1 << 1,
+		underscore = 1 << 2,
+		whitespace = 1 << 3,
+	};
+
+	constexpr auto make_char_classes() -> std::array<std::uint8_t, 256>
+	{
+		std::array<std::uint8_t, 256> classes{};
+		for (int c = 'a'; c <= 'z'; ++c)
+		{
+			classes[c] |= letter;
+		}
+		for (int c = 'A'; c <= 'Z'; ++c)
+		{
+			classes[c] |= letter;
+		}
+		for (int c = '0'; c <= '9'; ++c)
+		{
+			classes[c] |= digit;
+		}
+		classes['_'] |= underscore;
+		classes[' '] |= whitespace;
+		classes['\t'] |= whitespace;
+		classes['\n'] |= whitespace;
+		return classes;
+	}
+
+	constexpr std::array<std::uint8_t, 256> s_char_classes = make_char_classes();
+
+	template <std::uint8_t Classes>
+	auto scan_scalar(const char* first, const char* last) -> const char*
+	{
+		while (first != last && (s_char_classes[static_cast<unsigned char>(*first)] & Classes))
+		{
+			++first;
+		}
+		return first;
+	}
+
+	auto scan_line_scalar(const char* first, const char* last) -> const char*
+	{
+		while (first != last && *first != '\n')
+		{
+			++first;
+		}
+		return first;
+	}
+
+	auto count_trailing_zeros(std::uint32_t x) -> unsigned
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		unsigned long index;
+		_BitScanForward(&index, x);
+		return index;
+#else
+		return __builtin_ctz(x);
+#endif
+	}
+
+	auto scan_newlines_scalar(const char* first, const char* last, const char* base, std::vector<std::uint32_t>& offsets) -> void
+	{
+		for (; first != last; ++first)
+		{
+			if (*first == '\n')
+			{
+				offsets.push_back(static_cast<std::uint32_t>(first - base));
+			}
+		}
+	}
+
+	// Appends the offset of each set bit of a block's newline mask.
+	auto push_newlines(std::uint32_t mask, std::uint32_t offset, std::vector<std::uint32_t>& offsets) -> void
+	{
+		while (mask)
+		{
+			offsets.push_back(offset + count_trailing_zeros(mask));
+			mask &= mask - 1;
+		}
+	}
+
+#if EOP_SCAN_X86
+	/*
+	 * Each predicate maps a block of bytes to a mask with 0xff in the lanes that
+	 * belong to the run.  Bytes >= 0x80 are negative as signed chars and fail
+	 * every range check.
+	 */
+	struct Identifier_sse2
+	{
+		static auto match(__m128i c) -> __m128i
+		{
+			const __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+			const __m128i letter = _mm_and_si128(
+				_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+				_mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+			const __m128i digit = _mm_and_si128(
+				_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+				_mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+			const __m128i underscore = _mm_cmpeq_epi8(c, _mm_set1_epi8('_'));
+			return _mm_or_si128(_mm_or_si128(letter, digit), underscore);
+		}
+	};
+
+	struct Digits_sse2
+	{
+		static auto match(__m128i c) -> __m128i
+		{
+			return _mm_and_si128(
+				_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+				_mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+		}
+	};
+
+	struct Whitespace_sse2
+	{
+		static auto match(__m128i c) -> __m128i
+		{
+			return _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(c, _mm_set1_epi8('\t'))),
+				_mm_cmpeq_epi8(c, _mm_set1_epi8('\n')));
+		}
+	};
+
+	struct Line_sse2
+	{
+		static auto match(__m128i c) -> __m128i
+		{
+			return _mm_xor_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('\n')), _mm_set1_epi8(-1));
+		}
+	};
+
+	template <typename P>
+	auto scan_sse2(const char* first, const char* last) -> const char*
+	{
+		while (last - first >= 16)
+		{
+			const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+			const std::uint32_t stop = ~static_cast<std::uint32_t>(_mm_movemask_epi8(P::match(c))) & 0xffff;
+			if (stop)
+			{
+				return first + count_trailing_zeros(stop);
+			}
+			first += 16;
+		}
+		return first;
+	}
+
+	// Newlines are sparse in source, so most blocks cost a compare and a test.
+	auto scan_newlines_sse2(const char* first, const char* last, std::vector<std::uint32_t>& offsets) -> void
+	{
+		const char* base = first;
+		const __m128i newline = _mm_set1_epi8('\n');
+		for (; last - first >= 16; first += 16)
+		{
+			const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+			push_newlines(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, newline))), static_cast<std::uint32_t>(first - base), offsets);
+		}
+		scan_newlines_scalar(first, last, base, offsets);
+	}
+
+	struct Identifier_avx2
+	{
+		EOP_TARGET_AVX2 static auto match(__m256i c) -> __m256i
+		{
+			const __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+			const __m256i letter = _mm256_and_si256(
+				_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+				_mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+			const __m256i digit = _mm256_and_si256(
+				_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+				_mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+			const __m256i underscore = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_'));
+			return _mm256_or_si256(_mm256_or_si256(letter, digit), underscore);
+		}
+	};
+
+	struct Digits_avx2
+	{
+		EOP_TARGET_AVX2 static auto match(__m256i c) -> __m256i
+		{
+			return _mm256_and_si256(
+				_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+				_mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+		}
+	};
+
+	struct Whitespace_avx2
+	{
+		EOP_TARGET_AVX2 static auto match(__m256i c) -> __m256i
+		{
+			return _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\t'))),
+				_mm256_cmpeq_epi8(c, _mm256_set1_epi8('\n')));
+		}
+	};
+
+	struct Line_avx2
+	{
+		EOP_TARGET_AVX2 static auto match(__m256i c) -> __m256i
+		{
+			return _mm256_xor_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('\n')), _mm256_set1_epi8(-1));
+		}
+	};
+
+	template <typename P>
+	EOP_TARGET_AVX2 auto scan_avx2(const char* first, const char* last) -> const char*
+	{
+		while (last - first >= 32)
+		{
+			const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+			const std::uint32_t stop = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(P::match(c)));
+			if (stop)
+			{
+				return first + count_trailing_zeros(stop);
+			}
+			first += 32;
+		}
+		return first;
+	}
+
+	EOP_TARGET_AVX2 auto scan_newlines_avx2(const char* first, const char* last, std::vector<std::uint32_t>& offsets) -> void
+	{
+		const char* base = first;
+		const __m256i newline = _mm256_set1_epi8('\n');
+		for (; last - first >= 32; first += 32)
+		{
+			const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+			push_newlines(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, newline))), static_cast<std::uint32_t>(first - base), offsets);
+		}
+		scan_newlines_scalar(first, last, base, offsets);
+	}
+#endif
+
+	// The vector loops stop short of the end of the input; the scalar loop finishes the tail.
+	template <std::uint8_t Classes, typename Sse2, typename Avx2>
+	struct Scanner
+	{
+		static auto scalar(const char* first, const char* last) -> const char*
+		{
+			return scan_scalar<Classes>(first, last);
+		}
+
+#if EOP_SCAN_X86
+		static auto sse2(const char* first, const char* last) -> const char*
+		{
+			first = scan_sse2<Sse2>(first, last);
+			return scan_scalar<Classes>(first, last);
+		}
+
+		static auto avx2(const char* first, const char* last) -> const char*
+		{
+			first = scan_avx2<Avx2>(first, last);
+			return scan_scalar<Classes>(first, last);
+		}
+#endif
+	};
+
+	struct Line_scanner
+	{
+		static auto scalar(const char* first, const char* last) -> const char*
+		{
+			return scan_line_scalar(first, last);
+		}
+
+#if EOP_SCAN_X86
+		static auto sse2(const char* first, const char* last) -> const char*
+		{
+			first = scan_sse2<Line_sse2>(first, last);
+			return scan_line_scalar(first, last);
+		}
+
+		static auto avx2(const char* first, const char* last) -> const char*
+		{
+			first = scan_avx2<Line_avx2>(first, last);
+			return scan_line_scalar(first, last);
+		}
+#endif
+	};
+
+#if EOP_SCAN_X86
+	using Identifier_scanner = Scanner<letter | digit | underscore, Identifier_sse2, Identifier_avx2>;
+	using Digits_scanner = Scanner<digit, Digits_sse2, Digits_avx2>;
+	using Whitespace_scanner = Scanner<whitespace, Whitespace_sse2, Whitespace_avx2>;
+#else
+	using Identifier_scanner = Scanner<letter | digit | underscore, void, void>;
+	using Digits_scanner = Scanner<digit, void, void>;
+	using Whitespace_scanner = Scanner<whitespace, void, void>;
+#endif
+
+	using Scan_function = auto (*)(const char*, const char*) -> const char*;
+	using Newlines_function = auto (*)(const char*, const char*, std::vector<std::uint32_t>&) -> void;
+
+	struct Scan_functions
+	{
+		Scan_isa isa;
+		Scan_function identifier;
+		Scan_function digits;
+		Scan_function whitespace;
+		Scan_function line;
+		Newlines_function newlines;
+	};
+
+	auto scan_newlines_portable(const char* first, const char* last, std::vector<std::uint32_t>& offsets) -> void
+	{
+		scan_newlines_scalar(first, last, first, offsets);
+	}
+
+	constexpr auto newlines_function(Scan_isa isa) -> Newlines_function
+	{
+		switch (isa)
+		{
+#if EOP_SCAN_X86
+		case Scan_isa::avx2: {
+			return scan_newlines_avx2;
+		} break;
+
+		case Scan_isa::sse2: {
+			return scan_newlines_sse2;
+		} break;
+#endif
+
+		default: {
+			return scan_newlines_portable;
+		} break;
+		}
+	}
+
+	template <typename S>
+	constexpr auto scan_function(Scan_isa isa) -> Scan_function
+	{
+		switch (isa)
+		{
+#if EOP_SCAN_X86
+		case Scan_isa::avx2: {
+			return S::avx2;
+		} break;
+
+		case Scan_isa::sse2: {
+			return S::sse2;
+		} break;
+#endif
+
+		default: {
+			return S::scalar;
+		} break;
+		}
+	}
+
+	constexpr auto make_scan_functions(Scan_isa isa) -> Scan_functions
+	{
+		return Scan_functions{
+			isa,
+			scan_function<Identifier_scanner>(isa),
+			scan_function<Digits_scanner>(isa),
+			scan_function<Whitespace_scanner>(isa),
+			scan_function<Line_scanner>(isa),
+			newlines_function(isa),
+		};
+	}
+
+	auto best_isa() -> Scan_isa
+	{
+		if (scan_supported(Scan_isa::avx2))
+		{
+			return Scan_isa::avx2;
+		}
+
+		if (scan_supported(Scan_isa::sse2))
+		{
+			return Scan_isa::sse2;
+		}
+
+		return Scan_isa::scalar;
+	}
+
+	// Constant-initialized so that lexing during static initialization still works.
+	Scan_functions s_scan = make_scan_functions(Scan_isa::scalar);
+	[[maybe_unused]] const Scan_isa s_initial_isa = scan_select(best_isa());
+}
+
+auto scan_supported(Scan_isa isa) -> bool
+{
+	switch (isa)
+	{
+	case Scan_isa::scalar: {
+		return true;
+	} break;
+
+#if EOP_SCAN_X86
+	// SSE2 is part of the x86-64 baseline.
+	case Scan_isa::sse2: {
+		return true;
+	} break;
+
+	case Scan_isa::avx2: {
+#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+		{
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+	} break;
+#endif
+
+	default: {
+		return false;
+	} break;
+	}
+}
+
+auto scan_isa() -> Scan_isa
+{
+	return s_scan.isa;
+}
+
+auto scan_select(Scan_isa isa) -> Scan_isa
+{
+	Scan_isa previous = s_scan.isa;
+	s_scan = make_scan_functions(scan_supported(isa) ? isa : Scan_isa::scalar);
+	return previous;
+}
+
+auto scan_identifier(const char* first, const char* last) -> const char*
+{
+	return s_scan.identifier(first, last);
+}
+
+auto scan_digits(const char* first, const char* last) -> const char*
+{
+	return s_scan.digits(first, last);
+}
+
+auto scan_whitespace(const char* first, const char* last) -> const char*
+{
+	return s_scan.whitespace(first, last);
+}
+
+auto scan_line(const char* first, const char* last) -> const char*
+{
+	return s_scan.line(first, last);
+}
+
+auto scan_newlines(const char* first, const char* last, std::vector<std::uint32_t>& offsets) -> void
+{
+	s_scan.newlines(first, last, offsets);
+}
@@ -0,0 +1,42 @@
+#ifndef EOP_LANG_SCAN_H
+#define EOP_LANG_SCAN_H
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Byte scanners used by the lexer to skip runs of characters.  Each scanner
+ * returns the first position in [first, last) that does not belong to the run,
+ * or last.  The implementation is chosen at runtime from the instruction sets
+ * the processor supports and can be overridden with scan_select.
+ */
+
+enum class Scan_isa
+{
+	scalar,
+	sse2,
+	avx2,
+};
+
+auto scan_supported(Scan_isa isa) -> bool;
+auto scan_isa() -> Scan_isa;
+
+// Not thread-safe; intended for tests and benchmarks.  Returns the previous selection.
+auto scan_select(Scan_isa isa) -> Scan_isa;
+
+// [A-Za-z0-9_]
+auto scan_identifier(const char* first, const char* last) -> const char*;
+
+// [0-9]
+auto scan_digits(const char* first, const char* last) -> const char*;
+
+// [ \t\n]
+auto scan_whitespace(const char* first, const char* last) -> const char*;
+
+// Anything but '\n'.
+auto scan_line(const char* first, const char* last) -> const char*;
+
+// Appends the offset from first of every '\n' in [first, last) to offsets.
+auto scan_newlines(const char* first, const char* last, std::vector<std::uint32_t>& offsets) -> void;
+
+#endif
@@ -0,0 +1,113 @@
+#include "scan.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+	const Scan_isa s_isas[] = {Scan_isa::scalar, Scan_isa::sse2, Scan_isa::avx2};
+
+	// Runs of every length up to a few vector widths, stopped by every kind of byte.
+	template <typename F>
+	auto check_runs(F scan, char fill, const std::string& stops) -> void
+	{
+		for (Scan_isa isa : s_isas)
+		{
+			if (!scan_supported(isa))
+			{
+				continue;
+			}
+
+			const Scan_isa previous = scan_select(isa);
+			for (std::size_t length = 0; length < 100; ++length)
+			{
+				std::string input(length, fill);
+				const char* first = input.data();
+				REQUIRE(scan(first, first + input.size()) == first + length);
+
+				for (char stop : stops)
+				{
+					std::string stopped = input + stop + std::string(40, fill);
+					first = stopped.data();
+					REQUIRE(scan(first, first + stopped.size()) == first + length);
+				}
+			}
+			scan_select(previous);
+		}
+	}
+}
+
+TEST_CASE("Scan identifier runs", "[scan]")
+{
+	check_runs(scan_identifier, 'a', std::string("@[`{ /.:\n\x80\xff", 12));
+	check_runs(scan_identifier, 'Z', "@[`{-");
+	check_runs(scan_identifier, '_', "(");
+	check_runs(scan_identifier, '9', "/:");
+}
+
+TEST_CASE("Scan digit runs", "[scan]")
+{
+	check_runs(scan_digits, '0', std::string("/:a.\x80", 5));
+	check_runs(scan_digits, '9', "a");
+}
+
+TEST_CASE("Scan whitespace runs", "[scan]")
+{
+	check_runs(scan_whitespace, ' ', std::string("\r\v\0a", 4));
+	check_runs(scan_whitespace, '\t', "x");
+	check_runs(scan_whitespace, '\n', "x");
+}
+
+TEST_CASE("Scan to end of line", "[scan]")
+{
+	check_runs(scan_line, 'x', "\n");
+	check_runs(scan_line, '/', "\n");
+}
+
+TEST_CASE("Select unsupported instruction set", "[scan]")
+{
+	const Scan_isa previous = scan_select(Scan_isa::avx2);
+	REQUIRE(scan_isa() == (scan_supported(Scan_isa::avx2) ? Scan_isa::avx2 : Scan_isa::scalar));
+	scan_select(previous);
+	REQUIRE(scan_isa() == previous);
+}
+
+TEST_CASE("Scan for newlines", "[scan]")
+{
+	// Newlines at every position of a few vector widths, alone and in runs.
+	std::string input;
+	for (std::size_t i = 0; i < 200; ++i)
+	{
+		input += i % 7 == 0 || i % 31 < 3 ? '\n' : static_cast<char>('a' + i % 26);
+	}
+	input += std::string("\x80\xff\n\n", 4);
+
+	for (Scan_isa isa : s_isas)
+	{
+		if (!scan_supported(isa))
+		{
+			continue;
+		}
+
+		const Scan_isa previous = scan_select(isa);
+		for (std::size_t begin = 0; begin < 40; ++begin)
+		{
+			std::vector<std::uint32_t> expected;
+			for (std::size_t i = begin; i < input.size(); ++i)
+			{
+				if (input[i] == '\n')
+				{
+					expected.push_back(static_cast<std::uint32_t>(i - begin));
+				}
+			}
+
+			std::vector<std::uint32_t> offsets = {7};
+			scan_newlines(input.data() + begin, input.data() + input.size(), offsets);
+			expected.insert(expected.begin(), 7);
+			REQUIRE(offsets == expected);
+		}
+		scan_select(previous);
+	}
+}
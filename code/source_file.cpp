@@ -0,0 +1,279 @@
+#include "source_file.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct Source_file::Contents
+{
+	const char* data = nullptr;
+	std::size_t size = 0;
+	std::vector<char> buffer;
+#if defined(_WIN32)
+	HANDLE file = nullptr;
+	HANDLE mapping = nullptr;
+#endif
+
+	Contents() = default;
+	Contents(const Contents&) = delete;
+	Contents& operator=(const Contents&) = delete;
+
+	~Contents()
+	{
+		if (!is_mapped())
+		{
+			return;
+		}
+#if defined(_WIN32)
+		UnmapViewOfFile(data);
+		CloseHandle(mapping);
+		CloseHandle(file);
+#else
+		munmap(const_cast<char*>(data), size);
+#endif
+	}
+
+	auto is_mapped() const -> bool
+	{
+		return data && data != buffer.data();
+	}
+
+	auto adopt_buffer() -> void
+	{
+		// Never null, so that an empty input is still a valid range.
+		buffer.push_back('\0');
+		data = buffer.data();
+		size = buffer.size() - 1;
+	}
+};
+
+namespace
+{
+	constexpr std::size_t s_read_size = 64 * 1024;
+}
+
+#if defined(_WIN32)
+namespace
+{
+	auto read_all(HANDLE file, std::vector<char>& buffer) -> bool
+	{
+		while (true)
+		{
+			const std::size_t used = buffer.size();
+			buffer.resize(used + s_read_size);
+			DWORD count = 0;
+			const BOOL ok = ReadFile(file, buffer.data() + used, static_cast<DWORD>(s_read_size), &count, nullptr);
+			buffer.resize(used + count);
+			if (!ok)
+			{
+				// A pipe whose writer has gone reports a broken pipe instead of end of file.
+				return GetLastError() == ERROR_BROKEN_PIPE;
+			}
+			if (count == 0)
+			{
+				return true;
+			}
+		}
+	}
+}
+
+auto Source_file::open(const char* path, std::string& error) -> bool
+{
+	close();
+	auto contents = std::make_shared<Contents>();
+
+	if (std::strcmp(path, "-") == 0)
+	{
+		if (!read_all(GetStdHandle(STD_INPUT_HANDLE), contents->buffer))
+		{
+			error = "cannot read standard input";
+			return false;
+		}
+		contents->adopt_buffer();
+	}
+	else
+	{
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			error = "cannot open file";
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			const bool ok = read_all(file, contents->buffer);
+			CloseHandle(file);
+			if (!ok)
+			{
+				error = "cannot read file";
+				return false;
+			}
+			contents->adopt_buffer();
+		}
+		else
+		{
+			HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+			if (!data)
+			{
+				if (mapping)
+				{
+					CloseHandle(mapping);
+				}
+				CloseHandle(file);
+				error = "cannot map file";
+				return false;
+			}
+			contents->file = file;
+			contents->mapping = mapping;
+			contents->data = static_cast<const char*>(data);
+			contents->size = static_cast<std::size_t>(size.QuadPart);
+		}
+	}
+
+	m_begin = contents->data;
+	m_end = contents->data + contents->size;
+	m_contents = std::move(contents);
+	return true;
+}
+#else
+namespace
+{
+	auto read_all(int fd, std::vector<char>& buffer) -> bool
+	{
+		while (true)
+		{
+			const std::size_t used = buffer.size();
+			buffer.resize(used + s_read_size);
+			const ssize_t count = ::read(fd, buffer.data() + used, s_read_size);
+			buffer.resize(used + (count > 0 ? static_cast<std::size_t>(count) : 0));
+			if (count == 0)
+			{
+				return true;
+			}
+			if (count < 0 && errno != EINTR)
+			{
+				return false;
+			}
+		}
+	}
+}
+
+auto Source_file::open(const char* path, std::string& error) -> bool
+{
+	close();
+	auto contents = std::make_shared<Contents>();
+
+	const bool standard_input = std::strcmp(path, "-") == 0;
+	const int fd = standard_input ? STDIN_FILENO : ::open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		error = std::strerror(errno);
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) != 0)
+	{
+		error = std::strerror(errno);
+		if (!standard_input)
+		{
+			::close(fd);
+		}
+		return false;
+	}
+
+	if (S_ISDIR(status.st_mode))
+	{
+		error = std::strerror(EISDIR);
+		::close(fd);
+		return false;
+	}
+
+	// Files in procfs and the like report a size of zero, so read those too.
+	void* data = MAP_FAILED;
+	const auto size = static_cast<std::size_t>(status.st_size);
+	if (S_ISREG(status.st_mode) && size != 0)
+	{
+		data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+
+	if (data != MAP_FAILED)
+	{
+		// The lexer makes one forward pass, so ask for aggressive read-ahead.
+		posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+		contents->data = static_cast<const char*>(data);
+		contents->size = size;
+	}
+	else
+	{
+		if (!read_all(fd, contents->buffer))
+		{
+			error = std::strerror(errno);
+			if (!standard_input)
+			{
+				::close(fd);
+			}
+			return false;
+		}
+		contents->adopt_buffer();
+	}
+
+	// The mapping keeps its own reference to the file.
+	if (!standard_input)
+	{
+		::close(fd);
+	}
+
+	m_begin = contents->data;
+	m_end = contents->data + contents->size;
+	m_contents = std::move(contents);
+	return true;
+}
+#endif
+
+auto Source_file::close() -> void
+{
+	m_contents.reset();
+	m_begin = nullptr;
+	m_end = nullptr;
+}
+
+auto Source_file::is_open() const -> bool
+{
+	return m_contents != nullptr;
+}
+
+auto Source_file::is_mapped() const -> bool
+{
+	return m_contents && m_contents->is_mapped();
+}
+
+auto Source_file::begin() const -> const char*
+{
+	return m_begin;
+}
+
+auto Source_file::end() const -> const char*
+{
+	return m_end;
+}
+
+auto Source_file::size() const -> std::size_t
+{
+	return static_cast<std::size_t>(m_end - m_begin);
+}
@@ -0,0 +1,39 @@
+#ifndef EOP_LANG_SOURCE_FILE_H
+#define EOP_LANG_SOURCE_FILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/*
+ * The contents of a source file.  Regular files are mapped read-only into
+ * memory so that the lexer reads the page cache directly; pipes, character
+ * devices and standard input ("-") are read into a buffer instead.  Copies
+ * share the contents, which stay valid until the last copy is closed or
+ * destroyed, so anything holding pointers into them can hold a copy too.
+ */
+class Source_file
+{
+private:
+	struct Contents;
+
+	std::shared_ptr<const Contents> m_contents;
+	const char* m_begin = nullptr;
+	const char* m_end = nullptr;
+
+public:
+	// On failure returns false, leaves the file closed and describes the error.
+	auto open(const char* path, std::string& error) -> bool;
+	auto close() -> void;
+
+	auto is_open() const -> bool;
+
+	// False when the contents were read into a buffer.
+	auto is_mapped() const -> bool;
+
+	auto begin() const -> const char*;
+	auto end() const -> const char*;
+	auto size() const -> std::size_t;
+};
+
+#endif
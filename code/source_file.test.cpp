@@ -0,0 +1,109 @@
+#include "source_file.h"
+#include "token_buffer.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	auto temporary_path(const char* name) -> std::string
+	{
+		return (std::filesystem::temp_directory_path() / name).string();
+	}
+
+	auto write_file(const std::string& path, const std::string& text) -> void
+	{
+		std::ofstream(path, std::ios::binary) << text;
+	}
+}
+
+TEST_CASE("Source maps a regular file", "[source file]")
+{
+	const std::string path = temporary_path("eop_source_regular.eop");
+	const std::string text = "int main() { return 0; }\n";
+	write_file(path, text);
+
+	Source_file file;
+	std::string error;
+	REQUIRE(file.open(path.c_str(), error));
+	REQUIRE(file.is_mapped());
+	REQUIRE(std::string(file.begin(), file.end()) == text);
+
+	file.close();
+	REQUIRE(!file.is_open());
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("Source opens an empty file", "[source file]")
+{
+	const std::string path = temporary_path("eop_source_empty.eop");
+	write_file(path, "");
+
+	Source_file file;
+	std::string error;
+	REQUIRE(file.open(path.c_str(), error));
+	REQUIRE(file.begin() != nullptr);
+	REQUIRE(file.size() == 0);
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("Source reports a missing file", "[source file]")
+{
+	Source_file file;
+	std::string error;
+	REQUIRE(!file.open(temporary_path("eop_source_missing.eop").c_str(), error));
+	REQUIRE(!error.empty());
+	REQUIRE(!file.is_open());
+}
+
+TEST_CASE("Tokens keep their source alive", "[source file]")
+{
+	const std::string path = temporary_path("eop_source_alive.eop");
+	write_file(path, "struct pair { int first; int second; };");
+
+	Token_buffer buffer;
+	{
+		Source_file file;
+		std::string error;
+		REQUIRE(file.open(path.c_str(), error));
+		buffer = Token_buffer(file);
+	}
+	std::filesystem::remove(path);
+
+	REQUIRE(buffer.size() == 11);
+	REQUIRE(buffer.token(3).begin == buffer.source() + 14);
+	REQUIRE(std::string(buffer.token(3).begin, buffer.token(3).end) == "int");
+}
+
+#if !defined(_WIN32)
+TEST_CASE("Source reads a pipe", "[source file]")
+{
+	const std::string path = temporary_path("eop_source_pipe");
+	std::filesystem::remove(path);
+	REQUIRE(mkfifo(path.c_str(), 0600) == 0);
+
+	// Larger than one read so that the buffer has to grow.
+	const std::string text(200 * 1024, 'x');
+	std::thread writer([&path, &text] { write_file(path, text); });
+
+	Source_file file;
+	std::string error;
+	const bool opened = file.open(path.c_str(), error);
+	writer.join();
+	std::filesystem::remove(path);
+
+	REQUIRE(opened);
+	REQUIRE(!file.is_mapped());
+	REQUIRE(file.size() == text.size());
+	REQUIRE(std::string(file.begin(), file.end()) == text);
+}
+#endif
@@ -0,0 +1,138 @@
+#include "source_manager.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <utility>
+
+auto Source_manager::add(std::string name, Source_file file, const char* begin, const char* end, std::uint32_t& id, std::string& error) -> bool
+{
+	const auto size = static_cast<std::uint64_t>(end - begin);
+	if (!fits(size))
+	{
+		error = "source location space exhausted";
+		return false;
+	}
+
+	id = static_cast<std::uint32_t>(m_files.size());
+	m_files.push_back(Entry{std::move(name), std::move(file), begin, end, static_cast<Source_location>(m_next), Line_index(begin, end)});
+	m_next += size + 1;
+	return true;
+}
+
+auto Source_manager::load(const char* path, std::uint32_t& id, std::string& error) -> bool
+{
+	Source_file file;
+	if (!file.open(path, error))
+	{
+		return false;
+	}
+	return add(path, std::move(file), id, error);
+}
+
+auto Source_manager::add(std::string name, Source_file file, std::uint32_t& id, std::string& error) -> bool
+{
+	const char* begin = file.begin();
+	const char* end = file.end();
+	return add(std::move(name), std::move(file), begin, end, id, error);
+}
+
+auto Source_manager::add(std::string name, const char* begin, const char* end, std::uint32_t& id, std::string& error) -> bool
+{
+	return add(std::move(name), Source_file(), begin, end, id, error);
+}
+
+auto Source_manager::fits(std::uint64_t size) const -> bool
+{
+	// The file takes a location for each byte and one for its end.
+	return m_next + size <= std::numeric_limits<Source_location>::max();
+}
+
+auto Source_manager::size() const -> std::uint32_t
+{
+	return static_cast<std::uint32_t>(m_files.size());
+}
+
+auto Source_manager::name(std::uint32_t id) const -> const std::string&
+{
+	return m_files[id].name;
+}
+
+auto Source_manager::begin(std::uint32_t id) const -> const char*
+{
+	return m_files[id].begin;
+}
+
+auto Source_manager::end(std::uint32_t id) const -> const char*
+{
+	return m_files[id].end;
+}
+
+auto Source_manager::base(std::uint32_t id) const -> Source_location
+{
+	return m_files[id].base;
+}
+
+auto Source_manager::location(std::uint32_t id, std::uint32_t offset) const -> Source_location
+{
+	const Entry& entry = m_files[id];
+	assert(offset <= static_cast<std::size_t>(entry.end - entry.begin));
+	return entry.base + offset;
+}
+
+auto Source_manager::file(Source_location location) const -> std::uint32_t
+{
+	assert(location != s_invalid_location && location < m_next);
+
+	// The last file whose base is at or before the location.
+	const auto after = std::upper_bound(m_files.begin(), m_files.end(), location,
+		[](Source_location x, const Entry& entry) { return x < entry.base; });
+	return static_cast<std::uint32_t>(after - m_files.begin()) - 1;
+}
+
+auto Source_manager::offset(Source_location location) const -> std::uint32_t
+{
+	return location - m_files[file(location)].base;
+}
+
+auto Source_manager::resolve(Source_location location) const -> Presumed_location
+{
+	const std::uint32_t id = file(location);
+	const Entry& entry = m_files[id];
+	return Presumed_location{id, entry.lines.locate(location - entry.base)};
+}
+
+auto Source_set::manager_for(std::uint64_t size) -> Source_manager&
+{
+	// A file too large for any space is refused by an empty manager rather than a fresh one.
+	if (m_managers.empty() || (!m_managers.back().fits(size) && m_managers.back().size() != 0))
+	{
+		m_managers.emplace_back();
+	}
+	return m_managers.back();
+}
+
+auto Source_set::load(const char* path, Source_id& id, std::string& error) -> bool
+{
+	Source_file file;
+	if (!file.open(path, error))
+	{
+		return false;
+	}
+
+	Source_manager& manager = manager_for(file.size());
+	id.manager = &manager;
+	return manager.add(path, std::move(file), id.file, error);
+}
+
+auto Source_set::add(std::string name, const char* begin, const char* end, Source_id& id, std::string& error) -> bool
+{
+	Source_manager& manager = manager_for(static_cast<std::uint64_t>(end - begin));
+	id.manager = &manager;
+	return manager.add(std::move(name), begin, end, id.file, error);
+}
+
+auto Source_set::spaces() const -> std::size_t
+{
+	return m_managers.size();
+}
@@ -0,0 +1,116 @@
+#ifndef EOP_LANG_SOURCE_MANAGER_H
+#define EOP_LANG_SOURCE_MANAGER_H
+
+#include "location.h"
+#include "source_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/*
+ * A position in any file of a Source_manager.  Each file occupies a range of
+ * one 32-bit space, from its base to the location just after its last byte,
+ * so a token's location is its file's base plus the 32-bit offset the token
+ * buffer already stores, and which file it is in is a search of the bases.
+ */
+using Source_location = std::uint32_t;
+
+// Never the location of a byte; files start after it.
+static constexpr Source_location s_invalid_location = 0;
+
+// A location resolved to its file, line and column.
+struct Presumed_location
+{
+	std::uint32_t file;
+	Location location;
+};
+
+/*
+ * Holds the files of a build open and places them, in the order they are
+ * added, in one location space.  Files are only added, never removed, so
+ * locations stay valid for as long as the manager exists.  Resolving a
+ * location builds the line index of its file on first use, so files without
+ * diagnostics never scan for newlines.  Adding files and resolving locations
+ * are not thread-safe; looking up files and their contents is.
+ */
+class Source_manager
+{
+private:
+	struct Entry
+	{
+		std::string name;
+		Source_file file;
+		const char* begin;
+		const char* end;
+		Source_location base;
+		Line_index lines;
+	};
+
+	std::vector<Entry> m_files;
+
+	// Wider than a location, since the last file may end at the top of the space.
+	std::uint64_t m_next = s_invalid_location + 1;
+
+	auto add(std::string name, Source_file file, const char* begin, const char* end, std::uint32_t& id, std::string& error) -> bool;
+
+public:
+	// On failure returns false and describes the error, as when the location space is full.
+	auto load(const char* path, std::uint32_t& id, std::string& error) -> bool;
+	auto add(std::string name, Source_file file, std::uint32_t& id, std::string& error) -> bool;
+
+	// Adds text held elsewhere, which must outlive the manager.
+	auto add(std::string name, const char* begin, const char* end, std::uint32_t& id, std::string& error) -> bool;
+
+	// Whether a file of this many bytes would still fit in the location space.
+	auto fits(std::uint64_t size) const -> bool;
+
+	auto size() const -> std::uint32_t;
+	auto name(std::uint32_t id) const -> const std::string&;
+	auto begin(std::uint32_t id) const -> const char*;
+	auto end(std::uint32_t id) const -> const char*;
+	auto base(std::uint32_t id) const -> Source_location;
+
+	// offset may be the size of the file, for the end of its input.
+	auto location(std::uint32_t id, std::uint32_t offset) const -> Source_location;
+
+	// The file holding a valid location.
+	auto file(Source_location location) const -> std::uint32_t;
+	auto offset(Source_location location) const -> std::uint32_t;
+	auto resolve(Source_location location) const -> Presumed_location;
+};
+
+// A file of a Source_set: the manager whose location space holds it, and its id there.
+struct Source_id
+{
+	Source_manager* manager;
+	std::uint32_t file;
+};
+
+/*
+ * The sources of a build of any size.  Files go into one Source_manager
+ * until its location space is full, then into a new one, so locations are
+ * compact within each space and a batch of more than 4 GiB still loads;
+ * a location is only meaningful with the manager of its file.  Only a
+ * single file too large for a space of its own is refused.
+ */
+class Source_set
+{
+private:
+	std::deque<Source_manager> m_managers;
+
+	auto manager_for(std::uint64_t size) -> Source_manager&;
+
+public:
+	auto load(const char* path, Source_id& id, std::string& error) -> bool;
+
+	// Adds text held elsewhere, which must outlive the set.
+	auto add(std::string name, const char* begin, const char* end, Source_id& id, std::string& error) -> bool;
+
+	// The number of location spaces in use.
+	auto spaces() const -> std::size_t;
+};
+
+#endif
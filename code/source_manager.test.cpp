@@ -0,0 +1,139 @@
+#include "source_manager.h"
+#include "token_buffer.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+TEST_CASE("Sources share one location space", "[source manager]")
+{
+	const std::vector<std::string> texts = {"int f();\nint g();", "", "struct s\n{\n};\n"};
+
+	Source_manager sources;
+	std::string error;
+	for (std::size_t i = 0; i < texts.size(); ++i)
+	{
+		std::uint32_t id;
+		REQUIRE(sources.add("file" + std::to_string(i), texts[i].data(), texts[i].data() + texts[i].size(), id, error));
+		REQUIRE(id == i);
+	}
+	REQUIRE(sources.size() == texts.size());
+	REQUIRE(sources.name(2) == "file2");
+
+	// Every byte and every end has a location of its own that maps back to it.
+	Source_location previous = s_invalid_location;
+	for (std::uint32_t id = 0; id < sources.size(); ++id)
+	{
+		for (std::uint32_t offset = 0; offset <= texts[id].size(); ++offset)
+		{
+			const Source_location location = sources.location(id, offset);
+			REQUIRE(location > previous);
+			REQUIRE(sources.file(location) == id);
+			REQUIRE(sources.offset(location) == offset);
+			previous = location;
+		}
+	}
+
+	const Presumed_location presumed = sources.resolve(sources.location(2, 11));
+	REQUIRE(presumed.file == 2);
+	REQUIRE(presumed.location.line == 3);
+	REQUIRE(presumed.location.column == 1);
+	REQUIRE(sources.resolve(sources.location(0, 14)).location.line == 2);
+	REQUIRE(sources.resolve(sources.location(1, 0)).file == 1);
+}
+
+TEST_CASE("Token offsets become locations", "[source manager]")
+{
+	const std::string first = "int f() { }";
+	const std::string second = "int g()\n{\n  return x;\n}";
+
+	Source_manager sources;
+	std::string error;
+	std::uint32_t a;
+	std::uint32_t b;
+	REQUIRE(sources.add("a.eop", first.data(), first.data() + first.size(), a, error));
+	REQUIRE(sources.add("b.eop", second.data(), second.data() + second.size(), b, error));
+
+	const Token_buffer tokens(sources.begin(b), sources.end(b));
+	REQUIRE(std::string(tokens.token(6).begin, tokens.token(6).end) == "x");
+
+	const Presumed_location presumed = sources.resolve(sources.location(b, tokens.tokens().offset(6)));
+	REQUIRE(sources.name(presumed.file) == "b.eop");
+	REQUIRE(presumed.location.line == 3);
+	REQUIRE(presumed.location.column == 10);
+}
+
+TEST_CASE("Sources load files", "[source manager]")
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "eop_source_manager.eop").string();
+	const std::string text = "int main() { return 0; }\n";
+	std::ofstream(path, std::ios::binary) << text;
+
+	Source_manager sources;
+	std::string error;
+	std::uint32_t id;
+	REQUIRE(sources.load(path.c_str(), id, error));
+	REQUIRE(std::string(sources.begin(id), sources.end(id)) == text);
+	REQUIRE(sources.name(id) == path);
+
+	REQUIRE(!sources.load((path + ".missing").c_str(), id, error));
+	REQUIRE(!error.empty());
+	REQUIRE(sources.size() == 1);
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("Sources refuse files past the location space", "[source manager]")
+{
+	// The ranges are never read, so they need not be backed by memory.
+	const char* begin = reinterpret_cast<const char*>(std::uintptr_t(1) << 40);
+	const std::uint64_t half = std::uint64_t(1) << 31;
+
+	Source_manager sources;
+	std::string error;
+	std::uint32_t id;
+	REQUIRE(sources.add("first", begin, begin + half, id, error));
+	REQUIRE(!sources.add("second", begin, begin + half, id, error));
+	REQUIRE(!error.empty());
+	REQUIRE(sources.add("third", begin, begin + half - 3, id, error));
+	REQUIRE(sources.base(id) + (half - 3) == UINT32_MAX);
+	REQUIRE(sources.file(UINT32_MAX) == 1);
+}
+
+TEST_CASE("Source sets open a new space when one is full", "[source manager]")
+{
+	// The ranges are never read, so they need not be backed by memory.
+	const char* begin = reinterpret_cast<const char*>(std::uintptr_t(1) << 40);
+	const std::uint64_t half = std::uint64_t(1) << 31;
+	const std::string text = "int f();\nint g();";
+
+	Source_set sources;
+	std::string error;
+	Source_id first;
+	Source_id second;
+	Source_id third;
+	REQUIRE(sources.add("first", begin, begin + half, first, error));
+	REQUIRE(!first.manager->fits(half));
+	REQUIRE(sources.add("second", begin, begin + half, second, error));
+	REQUIRE(sources.add("third", text.data(), text.data() + text.size(), third, error));
+	REQUIRE(sources.spaces() == 2);
+	REQUIRE(first.manager != second.manager);
+	REQUIRE(third.manager == second.manager);
+
+	// Each file resolves within its own space.
+	const Presumed_location presumed = third.manager->resolve(third.manager->location(third.file, 9));
+	REQUIRE(third.manager->name(presumed.file) == "third");
+	REQUIRE(presumed.location.line == 2);
+	REQUIRE(presumed.location.column == 1);
+
+	// Only a file too large for an empty space is refused, without leaving an empty space behind.
+	Source_id huge;
+	REQUIRE(!sources.add("huge", begin, begin + (std::uint64_t(1) << 32), huge, error));
+	REQUIRE(!error.empty());
+	REQUIRE(sources.spaces() == 3);
+	REQUIRE(!sources.add("huge", begin, begin + (std::uint64_t(1) << 32), huge, error));
+	REQUIRE(sources.spaces() == 3);
+}
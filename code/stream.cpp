@@ -0,0 +1,275 @@
+#include "stream.h"
+
+#include <cstring>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	constexpr std::size_t s_read_size = 64 * 1024;
+}
+
+Stream_parser::Stream_parser(Report report, Atom_table* atoms) :
+	m_report(std::move(report))
+{
+	m_context.atoms = atoms;
+}
+
+auto Stream_parser::finish_declaration(std::size_t end, bool last) -> void
+{
+	const char* text = m_buffer.data();
+	bool parsed = parse_more(m_context, text + m_begin, text + end);
+
+	// As parse accepts a declaration cut off by the end of the input.
+	if (!parsed && last && m_context.position == m_context.tokens.size())
+	{
+		parsed = true;
+	}
+
+	// A declaration that failed inside a block may have left its scopes open.
+	while (m_context.symbols.depth() > 1)
+	{
+		m_context.symbols.pop_scope();
+	}
+
+	m_passed = m_passed && parsed;
+	++m_declarations;
+	m_tokens += m_context.tokens.size();
+	m_report(Stream_declaration{m_offset + m_begin, m_offset + end, parsed}, m_context);
+
+	m_begin = end;
+	m_significant = false;
+}
+
+auto Stream_parser::scan(bool last) -> void
+{
+	const std::size_t size = m_buffer.size();
+	std::size_t i = m_scanned;
+	for (; i < size; ++i)
+	{
+		const char c = m_buffer[i];
+		if (m_comment)
+		{
+			m_comment = c != '\n';
+			continue;
+		}
+
+		if (c == ' ' || c == '\n' || c == '\t')
+		{
+			continue;
+		}
+
+		if (c == '/')
+		{
+			// Only the next byte tells a comment from a division.
+			if (i + 1 == size && !last)
+			{
+				break;
+			}
+
+			if (i + 1 < size && m_buffer[i + 1] == '/')
+			{
+				m_comment = true;
+				++i;
+				continue;
+			}
+		}
+
+		if (m_closed)
+		{
+			m_closed = false;
+			if (c == ';')
+			{
+				finish_declaration(i + 1, false);
+				continue;
+			}
+			finish_declaration(m_close_end, false);
+		}
+
+		m_significant = true;
+		switch (c)
+		{
+		case '{': {
+			++m_depth;
+		} break;
+
+		case '}': {
+			// An unbalanced "}" ends a declaration that cannot parse.
+			if (m_depth == 0)
+			{
+				finish_declaration(i + 1, false);
+			}
+			else if (--m_depth == 0)
+			{
+				m_closed = true;
+				m_close_end = i + 1;
+			}
+		} break;
+
+		case ';': {
+			if (m_depth == 0)
+			{
+				finish_declaration(i + 1, false);
+			}
+		} break;
+
+		default: {
+		} break;
+		}
+	}
+	m_scanned = i;
+}
+
+auto Stream_parser::feed(const char* data, std::size_t size) -> void
+{
+	m_buffer.insert(m_buffer.end(), data, data + size);
+	scan(false);
+
+	// Moving the unfinished declaration to the front only once the reported
+	// bytes outweigh it keeps the copying linear in the stream.
+	if (m_begin != 0 && m_begin >= m_buffer.size() - m_begin)
+	{
+		m_buffer.erase(m_buffer.begin(), m_buffer.begin() + static_cast<std::ptrdiff_t>(m_begin));
+		m_offset += m_begin;
+		m_scanned -= m_begin;
+		m_close_end -= m_closed ? m_begin : 0;
+		m_begin = 0;
+	}
+}
+
+auto Stream_parser::finish() -> void
+{
+	scan(true);
+	if (m_closed)
+	{
+		m_closed = false;
+		finish_declaration(m_close_end, true);
+	}
+	else if (m_significant)
+	{
+		finish_declaration(m_buffer.size(), true);
+	}
+
+	m_offset += m_buffer.size();
+	m_buffer.clear();
+	m_begin = 0;
+	m_scanned = 0;
+	m_depth = 0;
+	m_comment = false;
+}
+
+auto Stream_parser::passed() const -> bool
+{
+	return m_passed;
+}
+
+auto Stream_parser::declarations() const -> std::uint64_t
+{
+	return m_declarations;
+}
+
+auto Stream_parser::tokens() const -> std::uint64_t
+{
+	return m_tokens;
+}
+
+auto Stream_parser::bytes() const -> std::uint64_t
+{
+	return m_offset + m_buffer.size();
+}
+
+auto Stream_parser::bytes_reserved() const -> std::size_t
+{
+	return m_buffer.capacity();
+}
+
+#if defined(_WIN32)
+auto parse_stream(const char* path, Stream_parser& parser, std::string& error) -> bool
+{
+	const bool standard_input = std::strcmp(path, "-") == 0;
+	HANDLE file = standard_input ? GetStdHandle(STD_INPUT_HANDLE) : CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		error = "cannot open file";
+		return false;
+	}
+
+	std::vector<char> chunk(s_read_size);
+	bool ok = true;
+	while (true)
+	{
+		DWORD count = 0;
+		if (!ReadFile(file, chunk.data(), static_cast<DWORD>(chunk.size()), &count, nullptr))
+		{
+			// A pipe whose writer has gone reports a broken pipe instead of end of file.
+			ok = GetLastError() == ERROR_BROKEN_PIPE;
+			break;
+		}
+		if (count == 0)
+		{
+			break;
+		}
+		parser.feed(chunk.data(), count);
+	}
+
+	if (!standard_input)
+	{
+		CloseHandle(file);
+	}
+	if (!ok)
+	{
+		error = "cannot read file";
+		return false;
+	}
+	parser.finish();
+	return true;
+}
+#else
+auto parse_stream(const char* path, Stream_parser& parser, std::string& error) -> bool
+{
+	const bool standard_input = std::strcmp(path, "-") == 0;
+	const int fd = standard_input ? STDIN_FILENO : ::open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		error = std::strerror(errno);
+		return false;
+	}
+
+	// A read returns whatever a pipe holds, so declarations are reported as they arrive.
+	std::vector<char> chunk(s_read_size);
+	ssize_t count;
+	while ((count = ::read(fd, chunk.data(), chunk.size())) != 0)
+	{
+		if (count < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			error = std::strerror(errno);
+			break;
+		}
+		parser.feed(chunk.data(), static_cast<std::size_t>(count));
+	}
+
+	if (!standard_input)
+	{
+		::close(fd);
+	}
+	if (count < 0)
+	{
+		return false;
+	}
+	parser.finish();
+	return true;
+}
+#endif
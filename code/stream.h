@@ -0,0 +1,82 @@
+#ifndef EOP_LANG_STREAM_H
+#define EOP_LANG_STREAM_H
+
+#include "parser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A top-level declaration as it appeared in the stream.
+struct Stream_declaration
+{
+	// Byte offsets in the stream, including any whitespace and comments before it.
+	std::uint64_t begin;
+	std::uint64_t end;
+	bool parsed;
+};
+
+/*
+ * Parses an input that arrives in chunks, one top-level declaration at a
+ * time.  Declarations are delimited as by find_declarations, but on bytes:
+ * a scan of braces, semicolons and comments that resumes where the last
+ * chunk ended, so tokens split across chunks are only lexed once the
+ * declaration holding them is complete.  Each declaration is reported as
+ * soon as it is known to be complete and its bytes are then released, so
+ * the buffer holds little more than the largest declaration.
+ */
+class Stream_parser
+{
+public:
+	// The context holds the tokens and tree of the declaration, valid until the call returns.
+	using Report = std::function<void(const Stream_declaration&, const Parser_context&)>;
+
+private:
+	Report m_report;
+	Parser_context m_context;
+
+	// The unreported bytes, which begin at stream offset m_offset.
+	std::vector<char> m_buffer;
+	std::uint64_t m_offset = 0;
+	std::size_t m_begin = 0;
+	std::size_t m_scanned = 0;
+
+	std::uint32_t m_depth = 0;
+	bool m_comment = false;
+	bool m_significant = false;
+
+	// A "}" has closed the outermost block at m_close_end; the declaration takes a ";" that follows.
+	bool m_closed = false;
+	std::size_t m_close_end = 0;
+
+	std::uint64_t m_declarations = 0;
+	std::uint64_t m_tokens = 0;
+	bool m_passed = true;
+
+	auto scan(bool last) -> void;
+	auto finish_declaration(std::size_t end, bool last) -> void;
+
+public:
+	// Interns names into atoms, or when null the process-wide pool, which keeps every name the stream holds.
+	explicit Stream_parser(Report report, Atom_table* atoms = nullptr);
+
+	auto feed(const char* data, std::size_t size) -> void;
+
+	// Reports whatever remains at the end of the stream.
+	auto finish() -> void;
+
+	// Whether the stream so far parses as parse would parse it whole.
+	auto passed() const -> bool;
+
+	auto declarations() const -> std::uint64_t;
+	auto tokens() const -> std::uint64_t;
+	auto bytes() const -> std::uint64_t;
+	auto bytes_reserved() const -> std::size_t;
+};
+
+// Feeds the file, or standard input for "-", to parser as it is read, then finishes it.
+auto parse_stream(const char* path, Stream_parser& parser, std::string& error) -> bool;
+
+#endif
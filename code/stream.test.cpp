@@ -0,0 +1,177 @@
+#include "corpus.h"
+#include "stream.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Streamed
+	{
+		std::vector<Stream_declaration> declarations;
+		std::vector<std::string> trees;
+		bool passed;
+		std::uint64_t tokens;
+	};
+
+	auto stream(const std::string& input, std::size_t chunk_size) -> Streamed
+	{
+		Streamed result;
+		Stream_parser parser([&result](const Stream_declaration& declaration, const Parser_context& context) {
+			result.declarations.push_back(declaration);
+			result.trees.push_back(declaration.parsed && !context.ast.empty() ? to_string(context.ast, context.tokens, context.ast.size() - 1) : "");
+		});
+
+		for (std::size_t i = 0; i < input.size(); i += chunk_size)
+		{
+			parser.feed(input.data() + i, std::min(chunk_size, input.size() - i));
+		}
+		parser.finish();
+
+		result.passed = parser.passed();
+		result.tokens = parser.tokens();
+		return result;
+	}
+}
+
+TEST_CASE("Stream declarations split at any byte", "[stream]")
+{
+	const std::string input =
+		"// Leading comment with { braces ; and semicolons\n"
+		"struct pair { int first; int second; };\n"
+		"int sum(pair p) { return p.first + p.second; } // trailing } comment\n"
+		"enum color { red, green };\n"
+		"double half(double x) { return x / 2.0; }\n"
+		"int main() { }";
+
+	Parser_context whole;
+	REQUIRE(parse(whole, input.data(), input.data() + input.size()));
+
+	const Streamed reference = stream(input, input.size());
+	REQUIRE(reference.passed);
+	REQUIRE(reference.declarations.size() == 5);
+	REQUIRE(reference.declarations.front().begin == 0);
+	REQUIRE(reference.declarations.back().end == input.size());
+	REQUIRE(reference.tokens == whole.tokens.size());
+	for (std::size_t i = 1; i < reference.declarations.size(); ++i)
+	{
+		REQUIRE(reference.declarations[i].begin == reference.declarations[i - 1].end);
+	}
+	REQUIRE(reference.trees[1] == "(unit (procedure sum (basic_type int) (parameter p (name pair))"
+		" (compound { (return return (binary + (member first (name p)) (member second (name p)))))))");
+
+	// Every token, and the comment markers, are split by some chunk boundary.
+	for (std::size_t chunk_size = 1; chunk_size <= 16; ++chunk_size)
+	{
+		CAPTURE(chunk_size);
+		const Streamed streamed = stream(input, chunk_size);
+		REQUIRE(streamed.passed);
+		REQUIRE(streamed.tokens == reference.tokens);
+		REQUIRE(streamed.trees == reference.trees);
+		REQUIRE(streamed.declarations.size() == reference.declarations.size());
+		for (std::size_t i = 0; i < reference.declarations.size(); ++i)
+		{
+			REQUIRE(streamed.declarations[i].begin == reference.declarations[i].begin);
+			REQUIRE(streamed.declarations[i].end == reference.declarations[i].end);
+		}
+	}
+}
+
+TEST_CASE("Stream agrees with parsing the whole input", "[stream]")
+{
+	const std::vector<std::string> inputs = {
+		"",
+		"// only a comment",
+		"struct s; struct s { s x; };",
+		"int f() { } }",
+		"struct s { } int g();",
+		"int f() { x = 1; } int g( ) { return y + ; } int h();",
+		"int f() { return 1; } int g(",
+		"template <typename T> struct s { T x; }; s<int> f();",
+		generate_corpus(16 * 1024),
+	};
+
+	for (const std::string& input : inputs)
+	{
+		CAPTURE(input);
+		const bool whole = parse(input.data(), input.data() + input.size());
+		REQUIRE(stream(input, 1).passed == whole);
+		REQUIRE(stream(input, 100).passed == whole);
+	}
+}
+
+TEST_CASE("Stream reports declarations after a failure", "[stream]")
+{
+	const Streamed streamed = stream("int f() { } x y z; int g() { } int h() { }", 3);
+	REQUIRE(!streamed.passed);
+	REQUIRE(streamed.declarations.size() == 4);
+	REQUIRE(streamed.declarations[0].parsed);
+	REQUIRE(!streamed.declarations[1].parsed);
+	REQUIRE(streamed.declarations[2].parsed);
+	REQUIRE(streamed.declarations[3].parsed);
+}
+
+TEST_CASE("Stream buffers only the declaration in progress", "[stream]")
+{
+	const std::string input = generate_corpus(4 << 20);
+	const std::size_t chunk_size = 4096;
+
+	std::uint64_t largest = 0;
+	Stream_parser parser([&largest](const Stream_declaration& declaration, const Parser_context&) {
+		largest = std::max(largest, declaration.end - declaration.begin);
+	});
+	for (std::size_t i = 0; i < input.size(); i += chunk_size)
+	{
+		parser.feed(input.data() + i, std::min(chunk_size, input.size() - i));
+	}
+	parser.finish();
+
+	REQUIRE(parser.passed());
+	REQUIRE(parser.bytes() == input.size());
+	REQUIRE(parser.bytes_reserved() <= 4 * (largest + chunk_size));
+}
+
+TEST_CASE("Stream interns into its own table", "[stream]")
+{
+	const std::string input = "int stream_test_scoped(int x) { return x; } int g() { return stream_test_scoped(1); }";
+	Atom_table atoms;
+	std::vector<Atom> names;
+	Stream_parser parser([&names](const Stream_declaration&, const Parser_context& context) {
+		names.push_back(context.tokens.atom(1));
+	}, &atoms);
+	parser.feed(input.data(), input.size());
+	parser.finish();
+
+	REQUIRE(parser.passed());
+	REQUIRE(names.size() == 2);
+	REQUIRE(names[0] == atoms.find("stream_test_scoped"));
+	REQUIRE(atoms.name(names[1]) == "g");
+	REQUIRE(atom_find("stream_test_scoped") == null_atom);
+}
+
+TEST_CASE("Stream a file", "[stream]")
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "eop_stream.eop").string();
+	const std::string text = generate_corpus(256 * 1024);
+	std::ofstream(path, std::ios::binary) << text;
+
+	std::uint64_t declarations = 0;
+	Stream_parser parser([&declarations](const Stream_declaration& declaration, const Parser_context&) {
+		declarations += declaration.parsed;
+	});
+	std::string error;
+	REQUIRE(parse_stream(path.c_str(), parser, error));
+	REQUIRE(parser.passed());
+	REQUIRE(declarations == parser.declarations());
+	REQUIRE(parser.bytes() == text.size());
+
+	Stream_parser missing([](const Stream_declaration&, const Parser_context&) { });
+	REQUIRE(!parse_stream((path + ".missing").c_str(), missing, error));
+	REQUIRE(!error.empty());
+	std::filesystem::remove(path);
+}
@@ -1,53 +1,169 @@
 #include "symbol.h"
 
+#include <algorithm>
 #include <cassert>
+#include <new>
 
-#include <unordered_map>
-#include <vector>
+Symbol::Symbol(Atom name, Symbol_kind kind) :
+	name(name),
+	kind(kind)
+{
+}
 
-using Symbol_table = std::unordered_map<std::string, Symbol>;
-static std::vector<Symbol_table> s_symbols;
+static constexpr unsigned s_initial_slot_bits = 8;
 
-auto symbols_initialize() -> void
+Symbol_table::Symbol_table() :
+	m_slots(std::size_t(1) << s_initial_slot_bits, Slot{null_atom, nullptr}),
+	m_shift(32 - s_initial_slot_bits),
+	m_scopes(1, 0)
 {
-	s_symbols.clear();
-	s_symbols.emplace_back();
 }
 
-Symbol::Symbol(const std::string& name, Symbol_kind kind) :
-	name(name),
-	kind(kind)
+// Atoms are dense, so Fibonacci hashing spreads consecutive ones across the table.
+auto Symbol_table::find_slot(Atom name) const -> std::size_t
+{
+	const std::size_t mask = m_slots.size() - 1;
+	for (std::size_t i = static_cast<std::uint32_t>(name * 2654435769u) >> m_shift; ; i = (i + 1) & mask)
+	{
+		if (m_slots[i].name == name || m_slots[i].name == null_atom)
+		{
+			return i;
+		}
+	}
+}
+
+auto Symbol_table::grow() -> void
+{
+	std::vector<Slot> slots(m_slots.size() * 2, Slot{null_atom, nullptr});
+	slots.swap(m_slots);
+	--m_shift;
+
+	for (const Slot& slot : slots)
+	{
+		if (slot.name != null_atom)
+		{
+			m_slots[find_slot(slot.name)] = slot;
+		}
+	}
+}
+
+auto Symbol_table::clear() -> void
+{
+	for (Binding* binding : m_undo)
+	{
+		binding->shadowed = m_free;
+		m_free = binding;
+	}
+	m_undo.clear();
+
+	std::fill(m_slots.begin(), m_slots.end(), Slot{null_atom, nullptr});
+	m_names = 0;
+	m_scopes.assign(1, 0);
+	m_pushes = 0;
+}
+
+auto Symbol_table::push_scope() -> void
+{
+	m_scopes.push_back(m_undo.size());
+}
+
+auto Symbol_table::pop_scope() -> void
 {
+	assert(m_scopes.size() > 1);
+	const std::size_t mark = m_scopes.back();
+	m_scopes.pop_back();
+
+	while (m_undo.size() > mark)
+	{
+		Binding* binding = m_undo.back();
+		m_undo.pop_back();
+
+		Slot& slot = m_slots[find_slot(binding->symbol.name)];
+		assert(slot.binding == binding);
+		slot.binding = binding->shadowed;
+
+		binding->shadowed = m_free;
+		m_free = binding;
+	}
 }
 
-auto symbol_push_scope() -> void
+auto Symbol_table::depth() const -> std::size_t
 {
-	s_symbols.emplace_back();
+	return m_scopes.size();
 }
 
-auto symbol_pop_scope() -> void
+auto Symbol_table::bindings() const -> std::size_t
 {
-	assert(s_symbols.size() > 1);
-	s_symbols.pop_back();
+	return m_undo.size();
 }
 
-auto symbol_push(const char* first, const char* last, Symbol_kind kind) -> const Symbol*
+auto Symbol_table::binding(std::size_t index) const -> const Symbol&
 {
-	assert(!s_symbols.empty());
-	// TODO May want to check if the already exists
-	std::string name(first, last);
-	return &(s_symbols.back()[name] = Symbol(name, kind));
+	return m_undo[index]->symbol;
 }
 
-auto symbol_get(const char* begin, const char* end) -> const Symbol*
+auto Symbol_table::push(Atom name, Symbol_kind kind) -> const Symbol*
 {
-	for (std::size_t i = s_symbols.size(); i > 0; --i)
+	assert(name != null_atom);
+
+	std::size_t index = find_slot(name);
+	if (m_slots[index].name == null_atom)
 	{
-		auto& symbols = s_symbols[i - 1];
-		if (auto iter = symbols.find(std::string(begin, end)); iter != symbols.end())
+		// Keep the load factor at or below one half.
+		if (2 * (m_names + 1) > m_slots.size())
 		{
-			return &iter->second;
+			grow();
+			index = find_slot(name);
 		}
+		m_slots[index].name = name;
+		++m_names;
+	}
+
+	Binding* binding = m_free;
+	if (binding)
+	{
+		m_free = binding->shadowed;
+	}
+	else
+	{
+		binding = static_cast<Binding*>(m_bindings.allocate(sizeof(Binding), alignof(Binding)));
+	}
+
+	Slot& slot = m_slots[index];
+	binding = new (binding) Binding{Symbol(name, kind), m_pushes++, slot.binding};
+	slot.binding = binding;
+	m_undo.push_back(binding);
+	return &binding->symbol;
+}
+
+auto Symbol_table::get(Atom name) const -> const Symbol*
+{
+	const Slot& slot = m_slots[find_slot(name)];
+	return slot.binding ? &slot.binding->symbol : nullptr;
+}
+
+auto Symbol_table::get(std::string_view name) const -> const Symbol*
+{
+	// A name that was never interned cannot have been declared.
+	const Atom atom = atom_find(name);
+	if (atom == null_atom)
+	{
+		return nullptr;
+	}
+	return get(atom);
+}
+
+auto Symbol_table::pushes() const -> std::uint32_t
+{
+	return m_pushes;
+}
+
+auto Symbol_table::get(Atom name, std::uint32_t before) const -> const Symbol*
+{
+	const Binding* binding = m_slots[find_slot(name)].binding;
+	while (binding && binding->ordinal >= before)
+	{
+		binding = binding->shadowed;
 	}
-	return nullptr;
+	return binding ? &binding->symbol : nullptr;
 }
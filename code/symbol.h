@@ -1,7 +1,13 @@
 #ifndef EOP_LANG_SYMBOL_H
 #define EOP_LANG_SYMBOL_H
 
-#include <string>
+#include "arena.h"
+#include "atom.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
 
 enum class Symbol_kind
 {
@@ -11,17 +17,88 @@ enum class Symbol_kind
 
 struct Symbol
 {
-	std::string name;
+	Atom name;
 	Symbol_kind kind;
 
 	Symbol() = default;
-	Symbol(const std::string& name, Symbol_kind kind);
+	Symbol(Atom name, Symbol_kind kind);
 };
 
-auto symbols_initialize() -> void;
-auto symbol_push_scope() -> void;
-auto symbol_pop_scope() -> void;
-auto symbol_push(const char* first, const char* last, Symbol_kind kind) -> const Symbol*;
-auto symbol_get(const char* first, const char* last) -> const Symbol*;
+/*
+ * Scoped symbol table.  One open-addressing table maps each name to its
+ * innermost binding, which links to the bindings it shadows; an undo log of
+ * the bindings made in each scope restores the outer bindings when the scope
+ * is popped.  Lookup is a single probe at any nesting depth, and entering or
+ * leaving a scope costs O(symbols declared in it) without allocating once the
+ * table has warmed up.
+ */
+class Symbol_table
+{
+private:
+	struct Binding
+	{
+		Symbol symbol;
+		std::uint32_t ordinal;
+		// The binding of the same name that this one hides, or the next free binding.
+		Binding* shadowed;
+	};
+
+	struct Slot
+	{
+		// Once a name has a slot it keeps it until clear, so there are no tombstones.
+		Atom name;
+		Binding* binding;
+	};
+
+	std::vector<Slot> m_slots;
+	unsigned m_shift;
+	std::size_t m_names = 0;
+	std::vector<Binding*> m_undo;
+	std::vector<std::size_t> m_scopes;
+	Arena m_bindings;
+	Binding* m_free = nullptr;
+	std::uint32_t m_pushes = 0;
+
+	auto find_slot(Atom name) const -> std::size_t;
+	auto grow() -> void;
+
+public:
+	Symbol_table();
+
+	Symbol_table(const Symbol_table&) = delete;
+	Symbol_table& operator=(const Symbol_table&) = delete;
+	Symbol_table(Symbol_table&&) = default;
+	Symbol_table& operator=(Symbol_table&&) = default;
+
+	// Removes every binding, leaving only the global scope.
+	auto clear() -> void;
+
+	auto push_scope() -> void;
+	auto pop_scope() -> void;
+	auto depth() const -> std::size_t;
+
+	// Bindings made in the open scopes.
+	auto bindings() const -> std::size_t;
+
+	// The symbol of one of those bindings, oldest first.
+	auto binding(std::size_t index) const -> const Symbol&;
+
+	// The returned symbol stays valid until its scope is popped.
+	auto push(Atom name, Symbol_kind kind) -> const Symbol*;
+	auto get(Atom name) const -> const Symbol*;
+
+	// Hashes name once to find its atom in the process-wide pool; never allocates.
+	auto get(std::string_view name) const -> const Symbol*;
+
+	// Pushes since the table was cleared; the binding made by push n has ordinal n.
+	auto pushes() const -> std::uint32_t;
+
+	/*
+	 * The innermost binding of name among those made by the first `before`
+	 * pushes, which is what get returned at that point provided no scope open
+	 * then has since been popped.
+	 */
+	auto get(Atom name, std::uint32_t before) const -> const Symbol*;
+};
 
 #endif
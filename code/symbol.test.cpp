@@ -0,0 +1,155 @@
+#include "allocations.h"
+#include "symbol.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+TEST_CASE("Look up symbols through nested scopes", "[symbol]")
+{
+	const Atom outer = atom_intern("symbol_test_outer");
+	const Atom inner = atom_intern("symbol_test_inner");
+	const Atom missing = atom_intern("symbol_test_missing");
+
+	Symbol_table symbols;
+	symbols.push(outer, Symbol_kind::type);
+	symbols.push_scope();
+	symbols.push(inner, Symbol_kind::procedure);
+	symbols.push_scope();
+	symbols.push(outer, Symbol_kind::procedure);
+
+	REQUIRE(symbols.get(outer)->kind == Symbol_kind::procedure);
+	REQUIRE(symbols.get(inner)->kind == Symbol_kind::procedure);
+	REQUIRE(symbols.get(missing) == nullptr);
+	REQUIRE(symbols.get("symbol_test_inner") == symbols.get(inner));
+	REQUIRE(symbols.get("symbol_test_never_interned") == nullptr);
+
+	symbols.pop_scope();
+	REQUIRE(symbols.get(outer)->kind == Symbol_kind::type);
+	symbols.pop_scope();
+	REQUIRE(symbols.get(inner) == nullptr);
+}
+
+TEST_CASE("Look up symbols without allocating", "[symbol]")
+{
+	const Atom name = atom_intern("symbol_test_allocation");
+	const Atom other = atom_intern("symbol_test_allocation_other");
+
+	Symbol_table symbols;
+	symbols.push(name, Symbol_kind::type);
+	for (int depth = 0; depth < 32; ++depth)
+	{
+		symbols.push_scope();
+		symbols.push(other, Symbol_kind::procedure);
+	}
+
+	start_counting_allocations();
+	const Symbol* by_atom = symbols.get(name);
+	const Symbol* by_name = symbols.get("symbol_test_allocation");
+	const Symbol* unknown = symbols.get("symbol_test_allocation_unknown");
+	const std::size_t allocations = stop_counting_allocations();
+
+	REQUIRE(allocations == 0);
+	REQUIRE(by_atom);
+	REQUIRE(by_atom == by_name);
+	REQUIRE(atom_name(by_atom->name) == "symbol_test_allocation");
+	REQUIRE(!unknown);
+}
+
+TEST_CASE("Shadow a name within one scope", "[symbol]")
+{
+	const Atom name = atom_intern("symbol_test_shadow");
+
+	Symbol_table symbols;
+	symbols.push_scope();
+	const Symbol* first = symbols.push(name, Symbol_kind::type);
+	const Symbol* second = symbols.push(name, Symbol_kind::procedure);
+	REQUIRE(symbols.get(name) == second);
+	REQUIRE(first->kind == Symbol_kind::type);
+
+	symbols.pop_scope();
+	REQUIRE(symbols.get(name) == nullptr);
+	REQUIRE(symbols.depth() == 1);
+}
+
+TEST_CASE("Look up symbols as of an earlier push", "[symbol]")
+{
+	const Atom pair = atom_intern("symbol_test_history_pair");
+	const Atom late = atom_intern("symbol_test_history_late");
+
+	Symbol_table symbols;
+	const Symbol* type = symbols.push(pair, Symbol_kind::type);
+	const std::uint32_t before_procedure = symbols.pushes();
+	const Symbol* procedure = symbols.push(pair, Symbol_kind::procedure);
+	symbols.push(late, Symbol_kind::type);
+	REQUIRE(symbols.pushes() == 3);
+
+	REQUIRE(symbols.get(pair, 0) == nullptr);
+	REQUIRE(symbols.get(pair, before_procedure) == type);
+	REQUIRE(symbols.get(pair, symbols.pushes()) == procedure);
+	REQUIRE(symbols.get(late, before_procedure) == nullptr);
+
+	symbols.clear();
+	REQUIRE(symbols.pushes() == 0);
+}
+
+TEST_CASE("Grow the table past its initial size", "[symbol]")
+{
+	std::vector<Atom> names;
+	for (int i = 0; i < 5000; ++i)
+	{
+		names.push_back(atom_intern("symbol_test_grow_" + std::to_string(i)));
+	}
+
+	Symbol_table symbols;
+	for (std::size_t i = 0; i < names.size(); ++i)
+	{
+		if (i % 100 == 0)
+		{
+			symbols.push_scope();
+		}
+		symbols.push(names[i], i % 2 ? Symbol_kind::type : Symbol_kind::procedure);
+	}
+
+	for (std::size_t i = 0; i < names.size(); ++i)
+	{
+		REQUIRE(symbols.get(names[i])->name == names[i]);
+	}
+
+	symbols.clear();
+	REQUIRE(symbols.get(names.front()) == nullptr);
+	REQUIRE(symbols.get(names.back()) == nullptr);
+}
+
+TEST_CASE("Enter and leave scopes without allocating", "[symbol]")
+{
+	const Atom x = atom_intern("symbol_test_scope_x");
+	const Atom y = atom_intern("symbol_test_scope_y");
+
+	Symbol_table symbols;
+	symbols.push(x, Symbol_kind::type);
+
+	auto nest = [&](int depth) {
+		for (int i = 0; i < depth; ++i)
+		{
+			symbols.push_scope();
+			symbols.push(x, Symbol_kind::procedure);
+			symbols.push(y, Symbol_kind::type);
+		}
+		for (int i = 0; i < depth; ++i)
+		{
+			symbols.pop_scope();
+		}
+	};
+
+	nest(64);
+
+	start_counting_allocations();
+	nest(64);
+	const std::size_t allocations = stop_counting_allocations();
+
+	REQUIRE(allocations == 0);
+	REQUIRE(symbols.get(x)->kind == Symbol_kind::type);
+	REQUIRE(symbols.get(y) == nullptr);
+}
@@ -0,0 +1,192 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+	struct Current_worker
+	{
+		const Thread_pool* pool;
+		std::size_t index;
+	};
+
+	thread_local Current_worker s_current{nullptr, 0};
+}
+
+Thread_pool::Thread_pool(unsigned thread_count)
+{
+	if (thread_count == 0)
+	{
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (unsigned i = 0; i < thread_count; ++i)
+	{
+		m_workers.push_back(std::make_unique<Worker>());
+	}
+
+	for (unsigned i = 0; i < thread_count; ++i)
+	{
+		m_threads.emplace_back([this, i] { run(i); });
+	}
+}
+
+Thread_pool::~Thread_pool()
+{
+	wait();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+auto Thread_pool::size() const -> std::size_t
+{
+	return m_workers.size();
+}
+
+auto Thread_pool::submit(Task task) -> void
+{
+	std::size_t index;
+	if (s_current.pool == this)
+	{
+		index = s_current.index;
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		index = m_next++ % m_workers.size();
+	}
+
+	{
+		Worker& worker = *m_workers[index];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_queued;
+		++m_unfinished;
+	}
+	m_wake.notify_one();
+}
+
+auto Thread_pool::wait() -> void
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this] { return m_unfinished == 0; });
+}
+
+auto Thread_pool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& f) -> void
+{
+	// Helpers can start after every index is claimed and the caller has
+	// returned, so they share ownership of the counters and only touch f
+	// after claiming an index.
+	struct State
+	{
+		const std::function<void(std::size_t)>* f;
+		std::size_t count;
+		std::atomic<std::size_t> next{0};
+		std::atomic<std::size_t> finished{0};
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+
+	auto state = std::make_shared<State>();
+	state->f = &f;
+	state->count = count;
+
+	auto work = [](State& state) {
+		std::size_t index;
+		while ((index = state.next++) < state.count)
+		{
+			(*state.f)(index);
+			if (++state.finished == state.count)
+			{
+				std::lock_guard<std::mutex> lock(state.mutex);
+				state.done.notify_all();
+			}
+		}
+	};
+
+	const std::size_t helpers = std::min(count, m_workers.size() + 1) - (count != 0);
+	for (std::size_t i = 0; i < helpers; ++i)
+	{
+		submit([state, work] { work(*state); });
+	}
+
+	work(*state);
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [&state] { return state->finished == state->count; });
+}
+
+auto Thread_pool::pop(std::size_t index, Task& task) -> bool
+{
+	{
+		Worker& own = *m_workers[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	for (std::size_t i = 1; i < m_workers.size(); ++i)
+	{
+		Worker& victim = *m_workers[(index + i) % m_workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+auto Thread_pool::run(std::size_t index) -> void
+{
+	s_current = Current_worker{this, index};
+
+	while (true)
+	{
+		Task task;
+		if (pop(index, task))
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				--m_queued;
+			}
+
+			task();
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_unfinished == 0)
+			{
+				m_idle.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_wake.wait(lock, [this] { return m_queued > 0 || m_stopping; });
+		if (m_stopping && m_queued == 0)
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef EOP_LANG_THREAD_POOL_H
+#define EOP_LANG_THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of worker threads with one task deque each.  A worker runs the
+ * newest task from its own deque and, when that is empty, steals the oldest
+ * task from another worker.  Tasks submitted by a worker go to its own deque;
+ * tasks submitted from outside are spread round-robin.
+ */
+class Thread_pool
+{
+public:
+	using Task = std::function<void()>;
+
+private:
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_idle;
+	std::size_t m_queued = 0;
+	std::size_t m_unfinished = 0;
+	std::size_t m_next = 0;
+	bool m_stopping = false;
+
+	auto run(std::size_t index) -> void;
+	auto pop(std::size_t index, Task& task) -> bool;
+
+public:
+	// Zero threads means one per hardware thread.
+	explicit Thread_pool(unsigned thread_count = 0);
+	~Thread_pool();
+
+	Thread_pool(const Thread_pool&) = delete;
+	Thread_pool& operator=(const Thread_pool&) = delete;
+
+	auto size() const -> std::size_t;
+	auto submit(Task task) -> void;
+
+	// Blocks until every submitted task, including those they submit, has finished.
+	auto wait() -> void;
+
+	// Calls f(i) for each i in [0, count) on the workers and the calling thread,
+	// returning once every call has finished.  Safe to call from a task.
+	auto parallel_for(std::size_t count, const std::function<void(std::size_t)>& f) -> void;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "thread_pool.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+
+TEST_CASE("Pool runs every task", "[thread pool]")
+{
+	std::atomic<int> count{0};
+	Thread_pool pool(4);
+	REQUIRE(pool.size() == 4);
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		pool.submit([&count] { ++count; });
+	}
+	pool.wait();
+	REQUIRE(count == 1000);
+
+	// The pool is reusable after waiting.
+	pool.submit([&count] { ++count; });
+	pool.wait();
+	REQUIRE(count == 1001);
+}
+
+TEST_CASE("Pool waits for nested tasks", "[thread pool]")
+{
+	std::atomic<int> count{0};
+	Thread_pool pool(3);
+
+	for (int i = 0; i < 10; ++i)
+	{
+		pool.submit([&pool, &count] {
+			for (int j = 0; j < 10; ++j)
+			{
+				pool.submit([&count] { ++count; });
+			}
+		});
+	}
+	pool.wait();
+	REQUIRE(count == 100);
+}
+
+TEST_CASE("Pool finishes tasks before destruction", "[thread pool]")
+{
+	std::atomic<int> count{0};
+	{
+		Thread_pool pool(2);
+		for (int i = 0; i < 100; ++i)
+		{
+			pool.submit([&count] { ++count; });
+		}
+	}
+	REQUIRE(count == 100);
+}
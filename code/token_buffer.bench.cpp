@@ -0,0 +1,41 @@
+#include "corpus.h"
+#include "thread_pool.h"
+#include "token_buffer.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Parallel lexing scaling", "[benchmark]")
+{
+	const std::string input = generate_corpus(64 << 20);
+	const char* input_begin = input.data();
+	const char* input_end = input_begin + input.size();
+
+	BENCHMARK("Lex 64 MiB serially")
+	{
+		return Token_buffer(input_begin, input_end).size();
+	};
+
+	// Powers of two up to the hardware thread count, and the count itself.
+	std::vector<unsigned> thread_counts;
+	const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned threads = 1; threads < hardware; threads *= 2)
+	{
+		thread_counts.push_back(threads);
+	}
+	thread_counts.push_back(hardware);
+
+	for (const unsigned threads : thread_counts)
+	{
+		Thread_pool pool(threads);
+		BENCHMARK("Lex 64 MiB on " + std::to_string(threads) + " threads")
+		{
+			return Token_buffer(input_begin, input_end, Lex_options(), pool).size();
+		};
+	}
+}
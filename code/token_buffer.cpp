@@ -0,0 +1,340 @@
+#include "token_buffer.h"
+#include "scan.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+auto Token_array::size() const -> std::uint32_t
+{
+	return static_cast<std::uint32_t>(m_kinds.size());
+}
+
+auto Token_array::empty() const -> bool
+{
+	return m_kinds.empty();
+}
+
+auto Token_array::kind(std::uint32_t index) const -> Token_kind
+{
+	assert(index < size());
+	return m_kinds[index];
+}
+
+auto Token_array::offset(std::uint32_t index) const -> std::uint32_t
+{
+	assert(index < size());
+	return m_offsets[index];
+}
+
+auto Token_array::length(std::uint32_t index) const -> std::uint32_t
+{
+	assert(index < size());
+	return m_lengths[index];
+}
+
+auto Token_array::push_back(Token_kind kind, std::uint32_t offset, std::uint32_t length) -> void
+{
+	m_kinds.push_back(kind);
+	m_offsets.push_back(offset);
+	m_lengths.push_back(length);
+}
+
+auto Token_array::reserve(std::size_t n) -> void
+{
+	m_kinds.reserve(n);
+	m_offsets.reserve(n);
+	m_lengths.reserve(n);
+}
+
+auto Token_array::resize(std::size_t n) -> void
+{
+	m_kinds.resize(n);
+	m_offsets.resize(n);
+	m_lengths.resize(n);
+}
+
+auto Token_array::clear() -> void
+{
+	m_kinds.clear();
+	m_offsets.clear();
+	m_lengths.clear();
+}
+
+auto Token_array::assign(std::uint32_t at, const Token_array& x, std::uint32_t bias) -> void
+{
+	assert(at + x.size() <= size());
+	std::copy(x.m_kinds.begin(), x.m_kinds.end(), m_kinds.begin() + at);
+	std::transform(x.m_offsets.begin(), x.m_offsets.end(), m_offsets.begin() + at,
+		[bias](std::uint32_t offset) { return offset + bias; });
+	std::copy(x.m_lengths.begin(), x.m_lengths.end(), m_lengths.begin() + at);
+}
+
+Token_buffer::Token_buffer(const char* begin, const char* end, Lex_options options) :
+	m_source(begin)
+{
+	if (static_cast<std::uint64_t>(end - begin) > std::numeric_limits<std::uint32_t>::max())
+	{
+		m_too_large = true;
+		return;
+	}
+
+	// Roughly one significant token per six bytes of typical source.
+	m_tokens.reserve(static_cast<std::size_t>(end - begin) / 6);
+	Atom_table& atoms = options.atoms ? *options.atoms : atom_pool();
+
+	const char* position = begin;
+	while (true)
+	{
+		if (options.trivia == Trivia::drop)
+		{
+			position = scan_whitespace(position, end);
+		}
+
+		if (position == end)
+		{
+			break;
+		}
+
+		const Token token = *Token_iterator(position, end);
+		const auto offset = static_cast<std::uint32_t>(token.begin - begin);
+		const auto length = static_cast<std::uint32_t>(token.end - token.begin);
+		if (!is_trivia(token.kind))
+		{
+			m_tokens.push_back(token.kind, offset, length);
+			if (options.intern)
+			{
+				const bool name = token.kind == Token_kind::identifier || is_keyword(token.kind);
+				m_atoms.push_back(name ? atoms.intern(std::string_view(token.begin, length)) : null_atom);
+			}
+		}
+		else if (options.trivia == Trivia::keep)
+		{
+			m_trivia.push_back(token.kind, offset, length);
+		}
+		position = token.end;
+	}
+}
+
+Token_buffer::Token_buffer(const Source_file& file, Lex_options options) :
+	Token_buffer(file.begin(), file.end(), options)
+{
+	m_file = file;
+}
+
+Token_buffer::Token_buffer(const char* begin, const char* end, Lex_options options, Thread_pool& pool, std::size_t chunk_size) :
+	m_source(begin)
+{
+	if (static_cast<std::uint64_t>(end - begin) > std::numeric_limits<std::uint32_t>::max())
+	{
+		m_too_large = true;
+		return;
+	}
+
+	/*
+	 * Every token ends at or before a newline (a comment runs up to but not
+	 * including it, and the newline is a token of its own), so the position
+	 * after a newline is never inside a token and lexing can restart there.
+	 */
+	const auto size = static_cast<std::size_t>(end - begin);
+	const std::size_t count = std::clamp<std::size_t>(size / std::max<std::size_t>(chunk_size, 1), 1, pool.size() * 4);
+	std::vector<const char*> bounds{begin};
+	for (std::size_t i = 1; i < count; ++i)
+	{
+		const char* split = std::max(begin + size / count * i, bounds.back());
+		split = scan_line(split, end);
+		if (split == end)
+		{
+			break;
+		}
+		bounds.push_back(split + 1);
+	}
+	bounds.push_back(end);
+
+	std::vector<Token_buffer> chunks(bounds.size() - 1);
+	pool.parallel_for(chunks.size(), [&](std::size_t i) {
+		chunks[i] = Token_buffer(bounds[i], bounds[i + 1], options);
+	});
+
+	std::vector<std::uint32_t> token_starts(chunks.size() + 1, 0);
+	std::vector<std::uint32_t> trivia_starts(chunks.size() + 1, 0);
+	for (std::size_t i = 0; i < chunks.size(); ++i)
+	{
+		token_starts[i + 1] = token_starts[i] + chunks[i].m_tokens.size();
+		trivia_starts[i + 1] = trivia_starts[i] + chunks[i].m_trivia.size();
+	}
+
+	m_tokens.resize(token_starts.back());
+	m_trivia.resize(trivia_starts.back());
+	if (options.intern)
+	{
+		m_atoms.resize(token_starts.back());
+	}
+
+	pool.parallel_for(chunks.size(), [&](std::size_t i) {
+		const auto bias = static_cast<std::uint32_t>(bounds[i] - begin);
+		m_tokens.assign(token_starts[i], chunks[i].m_tokens, bias);
+		m_trivia.assign(trivia_starts[i], chunks[i].m_trivia, bias);
+		if (options.intern)
+		{
+			std::copy(chunks[i].m_atoms.begin(), chunks[i].m_atoms.end(), m_atoms.begin() + token_starts[i]);
+		}
+	});
+}
+
+Token_buffer::Token_buffer(const Source_file& file, Lex_options options, Thread_pool& pool, std::size_t chunk_size) :
+	Token_buffer(file.begin(), file.end(), options, pool, chunk_size)
+{
+	m_file = file;
+}
+
+auto Token_buffer::source() const -> const char*
+{
+	return m_source;
+}
+
+auto Token_buffer::too_large() const -> bool
+{
+	return m_too_large;
+}
+
+auto Token_buffer::tokens() const -> const Token_array&
+{
+	return m_tokens;
+}
+
+auto Token_buffer::trivia() const -> const Token_array&
+{
+	return m_trivia;
+}
+
+auto Token_buffer::size() const -> std::uint32_t
+{
+	return m_tokens.size();
+}
+
+auto Token_buffer::kind(std::uint32_t index) const -> Token_kind
+{
+	return m_tokens.kind(index);
+}
+
+auto Token_buffer::token(std::uint32_t index) const -> Token
+{
+	const char* begin = m_source + m_tokens.offset(index);
+	return Token(begin, begin + m_tokens.length(index), m_tokens.kind(index));
+}
+
+auto Token_buffer::atom(std::uint32_t index) const -> Atom
+{
+	assert(index < size());
+	return m_atoms.empty() ? null_atom : m_atoms[index];
+}
+
+auto Token_buffer::begin() const -> Iterator
+{
+	return Iterator(*this, 0);
+}
+
+auto Token_buffer::end() const -> Iterator
+{
+	return Iterator(*this, size());
+}
+
+auto Token_buffer::Iterator::Arrow::operator->() const -> const Token*
+{
+	return &value;
+}
+
+Token_buffer::Iterator::Iterator(const Token_buffer& buffer, std::uint32_t index) :
+	m_buffer(&buffer),
+	m_index(index)
+{
+}
+
+auto Token_buffer::Iterator::index() const -> std::uint32_t
+{
+	return m_index;
+}
+
+auto Token_buffer::Iterator::operator*() const -> reference
+{
+	return m_buffer->token(m_index);
+}
+
+auto Token_buffer::Iterator::operator->() const -> pointer
+{
+	return Arrow{**this};
+}
+
+auto Token_buffer::Iterator::operator[](difference_type n) const -> reference
+{
+	return *(*this + n);
+}
+
+auto Token_buffer::Iterator::operator++() -> Iterator&
+{
+	++m_index;
+	return *this;
+}
+
+auto Token_buffer::Iterator::operator++(int) -> Iterator
+{
+	Iterator tmp = *this;
+	++*this;
+	return tmp;
+}
+
+auto Token_buffer::Iterator::operator--() -> Iterator&
+{
+	--m_index;
+	return *this;
+}
+
+auto Token_buffer::Iterator::operator--(int) -> Iterator
+{
+	Iterator tmp = *this;
+	--*this;
+	return tmp;
+}
+
+auto Token_buffer::Iterator::operator+=(difference_type n) -> Iterator&
+{
+	m_index = static_cast<std::uint32_t>(m_index + n);
+	return *this;
+}
+
+auto Token_buffer::Iterator::operator-=(difference_type n) -> Iterator&
+{
+	return *this += -n;
+}
+
+auto operator+(Token_buffer::Iterator x, Token_buffer::Iterator::difference_type n) -> Token_buffer::Iterator
+{
+	return x += n;
+}
+
+auto operator-(Token_buffer::Iterator x, Token_buffer::Iterator::difference_type n) -> Token_buffer::Iterator
+{
+	return x -= n;
+}
+
+auto operator-(const Token_buffer::Iterator& x, const Token_buffer::Iterator& y) -> Token_buffer::Iterator::difference_type
+{
+	return static_cast<Token_buffer::Iterator::difference_type>(x.index()) - y.index();
+}
+
+auto operator==(const Token_buffer::Iterator& x, const Token_buffer::Iterator& y) -> bool
+{
+	return x.index() == y.index();
+}
+
+auto operator!=(const Token_buffer::Iterator& x, const Token_buffer::Iterator& y) -> bool
+{
+	return !(x == y);
+}
+
+auto operator<(const Token_buffer::Iterator& x, const Token_buffer::Iterator& y) -> bool
+{
+	return x.index() < y.index();
+}
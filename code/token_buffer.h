@@ -0,0 +1,161 @@
+#ifndef EOP_LANG_TOKEN_BUFFER_H
+#define EOP_LANG_TOKEN_BUFFER_H
+
+#include "atom.h"
+#include "source_file.h"
+#include "token_iterator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+class Thread_pool;
+
+enum class Trivia
+{
+	drop,
+	keep,
+};
+
+struct Lex_options
+{
+	Trivia trivia = Trivia::drop;
+
+	// Give every identifier and keyword token the atom of its spelling.
+	bool intern = false;
+
+	// The table to intern into, or when null the process-wide pool.
+	Atom_table* atoms = nullptr;
+};
+
+/*
+ * Tokens stored as parallel arrays of kind, offset and length; offsets are
+ * relative to the start of the lexed input.
+ */
+class Token_array
+{
+private:
+	std::vector<Token_kind> m_kinds;
+	std::vector<std::uint32_t> m_offsets;
+	std::vector<std::uint32_t> m_lengths;
+
+public:
+	auto size() const -> std::uint32_t;
+	auto empty() const -> bool;
+
+	auto kind(std::uint32_t index) const -> Token_kind;
+	auto offset(std::uint32_t index) const -> std::uint32_t;
+	auto length(std::uint32_t index) const -> std::uint32_t;
+
+	auto push_back(Token_kind kind, std::uint32_t offset, std::uint32_t length) -> void;
+	auto reserve(std::size_t n) -> void;
+	auto resize(std::size_t n) -> void;
+	auto clear() -> void;
+
+	// Overwrites the tokens from index at onwards with those of x, adding bias to their offsets.
+	auto assign(std::uint32_t at, const Token_array& x, std::uint32_t bias) -> void;
+};
+
+/*
+ * The tokens of a whole input, lexed once.  Whitespace and comments are
+ * either dropped or kept in a separate trivia array so that the significant
+ * tokens are contiguous.  In interning mode each name token also carries an
+ * atom, hashed once while lexing.  A raw input must outlive the buffer; a
+ * source file is kept open by the buffer for as long as it exists.  Offsets
+ * are 32 bits, so an input over 4 GiB is not lexed at all: the buffer is
+ * left empty and too_large reports it.
+ */
+class Token_buffer
+{
+public:
+	class Iterator;
+
+private:
+	const char* m_source = nullptr;
+	Token_array m_tokens;
+	Token_array m_trivia;
+	std::vector<Atom> m_atoms;
+	Source_file m_file;
+	bool m_too_large = false;
+
+public:
+	Token_buffer() = default;
+	Token_buffer(const char* begin, const char* end, Lex_options options = Lex_options());
+	explicit Token_buffer(const Source_file& file, Lex_options options = Lex_options());
+
+	/*
+	 * Splits the input after newlines into chunks of at least chunk_size bytes,
+	 * lexes the chunks on the pool and joins the results, which are the same
+	 * as lexing serially.
+	 */
+	Token_buffer(const char* begin, const char* end, Lex_options options, Thread_pool& pool, std::size_t chunk_size = 1 << 20);
+	Token_buffer(const Source_file& file, Lex_options options, Thread_pool& pool, std::size_t chunk_size = 1 << 20);
+
+	auto source() const -> const char*;
+
+	// Whether the input was too large to lex, which parsing reports as a failure.
+	auto too_large() const -> bool;
+
+	auto tokens() const -> const Token_array&;
+	auto trivia() const -> const Token_array&;
+
+	auto size() const -> std::uint32_t;
+	auto kind(std::uint32_t index) const -> Token_kind;
+	auto token(std::uint32_t index) const -> Token;
+
+	// null_atom for tokens that are not names or when not interning.
+	auto atom(std::uint32_t index) const -> Atom;
+
+	auto begin() const -> Iterator;
+	auto end() const -> Iterator;
+};
+
+// Dereferencing yields a Token by value, rebuilt from the arrays.
+class Token_buffer::Iterator
+{
+public:
+	struct Arrow
+	{
+		Token value;
+
+		auto operator->() const -> const Token*;
+	};
+
+	using value_type = Token;
+	using reference = Token;
+	using pointer = Arrow;
+	using difference_type = std::ptrdiff_t;
+	using iterator_category = std::random_access_iterator_tag;
+
+private:
+	const Token_buffer* m_buffer = nullptr;
+	std::uint32_t m_index = 0;
+
+public:
+	Iterator() = default;
+	Iterator(const Token_buffer& buffer, std::uint32_t index);
+
+	auto index() const -> std::uint32_t;
+
+	auto operator*() const -> reference;
+	auto operator->() const -> pointer;
+	auto operator[](difference_type n) const -> reference;
+
+	auto operator++() -> Iterator&;
+	auto operator++(int) -> Iterator;
+	auto operator--() -> Iterator&;
+	auto operator--(int) -> Iterator;
+	auto operator+=(difference_type n) -> Iterator&;
+	auto operator-=(difference_type n) -> Iterator&;
+};
+
+auto operator+(Token_buffer::Iterator x, Token_buffer::Iterator::difference_type n) -> Token_buffer::Iterator;
+auto operator-(Token_buffer::Iterator x, Token_buffer::Iterator::difference_type n) -> Token_buffer::Iterator;
+auto operator-(const Token_buffer::Iterator& x, const Token_buffer::Iterator& y) -> Token_buffer::Iterator::difference_type;
+
+auto operator==(const Token_buffer::Iterator& x, const Token_buffer::Iterator& y) -> bool;
+auto operator!=(const Token_buffer::Iterator& x, const Token_buffer::Iterator& y) -> bool;
+auto operator<(const Token_buffer::Iterator& x, const Token_buffer::Iterator& y) -> bool;
+
+#endif
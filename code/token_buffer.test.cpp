@@ -0,0 +1,150 @@
+#include "thread_pool.h"
+#include "token_buffer.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <vector>
+
+TEST_CASE("Buffer empty input", "[token buffer]")
+{
+	const char input[] = "";
+	const char* input_end = input + sizeof(input) - 1;
+
+	Token_buffer buffer(input, input_end);
+	REQUIRE(buffer.size() == 0);
+	REQUIRE(buffer.begin() == buffer.end());
+}
+
+TEST_CASE("Buffer drops trivia", "[token buffer]")
+{
+	const char input[] = "int main() // entry\n{\treturn 0; }";
+	const char* input_end = input + sizeof(input) - 1;
+
+	std::vector<Token> expected;
+	for (Token_iterator iter(input, input_end), end(input_end, input_end); iter != end; ++iter)
+	{
+		if (!is_trivia(iter->kind))
+		{
+			expected.push_back(*iter);
+		}
+	}
+
+	Token_buffer buffer(input, input_end);
+	REQUIRE(buffer.size() == expected.size());
+	REQUIRE(buffer.trivia().empty());
+
+	auto iter = buffer.begin();
+	for (const Token& token : expected)
+	{
+		REQUIRE(iter->begin == token.begin);
+		REQUIRE(iter->end == token.end);
+		REQUIRE(iter->kind == token.kind);
+		++iter;
+	}
+	REQUIRE(iter == buffer.end());
+}
+
+TEST_CASE("Buffer keeps trivia in side array", "[token buffer]")
+{
+	const char input[] = "a // b\n\tc";
+	const char* input_end = input + sizeof(input) - 1;
+
+	Token_buffer buffer(input, input_end, Lex_options{Trivia::keep});
+	REQUIRE(buffer.size() == 2);
+	REQUIRE(buffer.kind(0) == Token_kind::identifier);
+	REQUIRE(buffer.tokens().offset(1) == 8);
+
+	const Token_array& trivia = buffer.trivia();
+	REQUIRE(trivia.size() == 4);
+	REQUIRE(trivia.kind(0) == Token_kind::space);
+	REQUIRE(trivia.kind(1) == Token_kind::comment);
+	REQUIRE(trivia.offset(1) == 2);
+	REQUIRE(trivia.length(1) == 4);
+	REQUIRE(trivia.kind(2) == Token_kind::newline);
+	REQUIRE(trivia.kind(3) == Token_kind::tab);
+}
+
+TEST_CASE("Buffer iterator arithmetic", "[token buffer]")
+{
+	const char input[] = "x = y + 1;";
+	const char* input_end = input + sizeof(input) - 1;
+
+	Token_buffer buffer(input, input_end);
+	REQUIRE(buffer.end() - buffer.begin() == 6);
+
+	auto iter = buffer.begin() + 3;
+	REQUIRE(iter->kind == Token_kind::plus);
+	REQUIRE(iter[-1].kind == Token_kind::identifier);
+	REQUIRE((--iter)->begin == input + 4);
+	REQUIRE(iter < buffer.end());
+}
+
+TEST_CASE("Buffer interns names", "[token buffer]")
+{
+	const char input[] = "pair(x, y) x.first int";
+	const char* input_end = input + sizeof(input) - 1;
+
+	Token_buffer buffer(input, input_end, Lex_options{Trivia::drop, true});
+	REQUIRE(buffer.size() == 10);
+	REQUIRE(buffer.atom(0) == atom_intern("pair"));
+	REQUIRE(buffer.atom(1) == null_atom);
+	REQUIRE(buffer.atom(2) == buffer.atom(6));
+	REQUIRE(buffer.atom(2) != buffer.atom(4));
+	REQUIRE(atom_name(buffer.atom(8)) == "first");
+	REQUIRE(atom_name(buffer.atom(9)) == "int");
+
+	Token_buffer plain(input, input_end);
+	REQUIRE(plain.atom(0) == null_atom);
+}
+
+TEST_CASE("Parallel lexing matches serial", "[token buffer]")
+{
+	// Chunks this small split inside comments' lines, runs of blank lines and the very end.
+	const char input[] = "int a; // one\n\n\n// two\nb = 1.5 + .25;\n\tstruct s { int x; };\n//\nc";
+	const char* input_end = input + sizeof(input) - 1;
+
+	Thread_pool pool(3);
+	for (const Lex_options options : {Lex_options{Trivia::drop, false}, Lex_options{Trivia::keep, true}})
+	{
+		const Token_buffer serial(input, input_end, options);
+		for (std::size_t chunk_size = 1; chunk_size < sizeof(input); ++chunk_size)
+		{
+			const Token_buffer parallel(input, input_end, options, pool, chunk_size);
+			REQUIRE(parallel.size() == serial.size());
+			for (std::uint32_t i = 0; i < serial.size(); ++i)
+			{
+				REQUIRE(parallel.kind(i) == serial.kind(i));
+				REQUIRE(parallel.tokens().offset(i) == serial.tokens().offset(i));
+				REQUIRE(parallel.tokens().length(i) == serial.tokens().length(i));
+				REQUIRE(parallel.atom(i) == serial.atom(i));
+			}
+
+			REQUIRE(parallel.trivia().size() == serial.trivia().size());
+			for (std::uint32_t i = 0; i < serial.trivia().size(); ++i)
+			{
+				REQUIRE(parallel.trivia().kind(i) == serial.trivia().kind(i));
+				REQUIRE(parallel.trivia().offset(i) == serial.trivia().offset(i));
+			}
+		}
+	}
+}
+
+TEST_CASE("Buffer refuses input past 32-bit offsets", "[token buffer]")
+{
+	// The range is never read, so it need not be backed by memory.
+	const char* begin = reinterpret_cast<const char*>(std::uintptr_t(1) << 40);
+	const char* end = begin + (std::uint64_t(1) << 32) + 1;
+
+	const Token_buffer serial(begin, end);
+	REQUIRE(serial.too_large());
+	REQUIRE(serial.size() == 0);
+
+	Thread_pool pool(2);
+	const Token_buffer parallel(begin, end, Lex_options(), pool);
+	REQUIRE(parallel.too_large());
+	REQUIRE(parallel.size() == 0);
+
+	const char input[] = "int x;";
+	REQUIRE(!Token_buffer(input, input + sizeof(input) - 1).too_large());
+}
@@ -0,0 +1,82 @@
+#include "corpus.h"
+#include "token_buffer.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+namespace
+{
+	// The keywords tried one after another by parse_declaration, parse_control_statement and parse_primary.
+	const std::string_view s_spellings[] = {
+		"enum", "struct", "template", "return", "if", "switch", "while",
+		"do", "break", "goto", "true", "false", "bool", "int", "double", "typename", "const",
+	};
+
+	const Token_kind s_kinds[] = {
+		Token_kind::keyword_enum, Token_kind::keyword_struct, Token_kind::keyword_template,
+		Token_kind::keyword_return, Token_kind::keyword_if, Token_kind::keyword_switch,
+		Token_kind::keyword_while, Token_kind::keyword_do, Token_kind::keyword_break,
+		Token_kind::keyword_goto, Token_kind::keyword_true, Token_kind::keyword_false,
+		Token_kind::keyword_bool, Token_kind::keyword_int, Token_kind::keyword_double,
+		Token_kind::keyword_typename, Token_kind::keyword_const,
+	};
+}
+
+TEST_CASE("Keyword recognition", "[benchmark]")
+{
+	const std::string input = generate_corpus(1 << 20);
+	const char* input_begin = input.data();
+	const char* input_end = input_begin + input.size();
+	const Token_buffer tokens(input_begin, input_end);
+
+	BENCHMARK("Lex 1 MiB with keyword hashing")
+	{
+		return Token_buffer(input_begin, input_end).size();
+	};
+
+	BENCHMARK("Keyword checks by spelling")
+	{
+		std::size_t matches = 0;
+		for (std::uint32_t i = 0; i < tokens.size(); ++i)
+		{
+			const Token_kind kind = tokens.kind(i);
+			if (kind != Token_kind::identifier && !is_keyword(kind))
+			{
+				continue;
+			}
+
+			const Token token = tokens.token(i);
+			for (std::string_view spelling : s_spellings)
+			{
+				if (std::equal(token.begin, token.end, spelling.begin(), spelling.end()))
+				{
+					++matches;
+					break;
+				}
+			}
+		}
+		return matches;
+	};
+
+	BENCHMARK("Keyword checks by kind")
+	{
+		std::size_t matches = 0;
+		for (std::uint32_t i = 0; i < tokens.size(); ++i)
+		{
+			const Token_kind kind = tokens.kind(i);
+			for (Token_kind keyword : s_kinds)
+			{
+				if (kind == keyword)
+				{
+					++matches;
+					break;
+				}
+			}
+		}
+		return matches;
+	};
+}
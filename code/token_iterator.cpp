@@ -1,86 +1,199 @@
 #include "token_iterator.h"
+#include "scan.h"
 
-#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
 
-auto is_letter(char c) -> bool
+namespace
 {
-	switch (c)
+	// How the first byte of a token decides the rest of it.
+	enum class Lead : std::uint8_t
 	{
-	case 'a':
-	case 'b':
-	case 'c':
-	case 'd':
-	case 'e':
-	case 'f':
-	case 'g':
-	case 'h':
-	case 'i':
-	case 'j':
-	case 'k':
-	case 'l':
-	case 'm':
-	case 'n':
-	case 'o':
-	case 'p':
-	case 'q':
-	case 'r':
-	case 's':
-	case 't':
-	case 'u':
-	case 'v':
-	case 'w':
-	case 'x':
-	case 'y':
-	case 'z':
-	case 'A':
-	case 'B':
-	case 'C':
-	case 'D':
-	case 'E':
-	case 'F':
-	case 'G':
-	case 'H':
-	case 'I':
-	case 'J':
-	case 'K':
-	case 'L':
-	case 'M':
-	case 'N':
-	case 'O':
-	case 'P':
-	case 'Q':
-	case 'R':
-	case 'S':
-	case 'T':
-	case 'U':
-	case 'V':
-	case 'W':
-	case 'X':
-	case 'Y':
-	case 'Z': {
-		return true;
-	} break;
+		single,
+		pair,
+		identifier,
+		number,
+		dot,
+		slash,
+	};
+
+	struct Lead_tables
+	{
+		std::array<Lead, 256> lead{};
+		std::array<Token_kind, 256> kind{};
+		std::array<char, 256> pair_next{};
+		std::array<Token_kind, 256> pair_kind{};
+	};
 
-	default: {
-		return false;
-	} break;
+	constexpr auto make_lead_tables() -> Lead_tables
+	{
+		Lead_tables tables{};
+		for (auto& kind : tables.kind)
+		{
+			kind = Token_kind::invalid;
+		}
+
+		for (int c = 'a'; c <= 'z'; ++c)
+		{
+			tables.lead[c] = Lead::identifier;
+		}
+		for (int c = 'A'; c <= 'Z'; ++c)
+		{
+			tables.lead[c] = Lead::identifier;
+		}
+		tables.lead['_'] = Lead::identifier;
+		for (int c = '0'; c <= '9'; ++c)
+		{
+			tables.lead[c] = Lead::number;
+		}
+		tables.lead['.'] = Lead::dot;
+		tables.lead['/'] = Lead::slash;
+
+		tables.kind['('] = Token_kind::open_paren;
+		tables.kind[')'] = Token_kind::close_paren;
+		tables.kind['['] = Token_kind::open_bracket;
+		tables.kind[']'] = Token_kind::close_bracket;
+		tables.kind['{'] = Token_kind::open_brace;
+		tables.kind['}'] = Token_kind::close_brace;
+		tables.kind[','] = Token_kind::comma;
+		tables.kind[' '] = Token_kind::space;
+		tables.kind['\n'] = Token_kind::newline;
+		tables.kind['\t'] = Token_kind::tab;
+		tables.kind[';'] = Token_kind::semicolon;
+		tables.kind['-'] = Token_kind::minus;
+		tables.kind['*'] = Token_kind::star;
+		tables.kind['%'] = Token_kind::percent;
+		tables.kind['+'] = Token_kind::plus;
+		tables.kind[':'] = Token_kind::colon;
+		tables.kind['~'] = Token_kind::tilde;
+
+		struct Pair
+		{
+			char first;
+			Token_kind single;
+			char second;
+			Token_kind pair;
+		};
+
+		constexpr Pair pairs[] = {
+			{'&', Token_kind::ampersand, '&', Token_kind::double_ampersand},
+			{'|', Token_kind::pipe, '|', Token_kind::double_pipe},
+			{'!', Token_kind::bang, '=', Token_kind::bang_equals},
+			{'=', Token_kind::equals, '=', Token_kind::double_equals},
+			{'<', Token_kind::less, '=', Token_kind::less_equals},
+			{'>', Token_kind::greater, '=', Token_kind::greater_equals},
+		};
+
+		for (const Pair& pair : pairs)
+		{
+			const auto c = static_cast<unsigned char>(pair.first);
+			tables.lead[c] = Lead::pair;
+			tables.kind[c] = pair.single;
+			tables.pair_next[c] = pair.second;
+			tables.pair_kind[c] = pair.pair;
+		}
+
+		return tables;
+	}
+
+	constexpr Lead_tables s_lead = make_lead_tables();
+
+	auto is_digit(char c) -> bool
+	{
+		return c >= '0' && c <= '9';
 	}
+
+	struct Keyword
+	{
+		std::string_view spelling;
+		Token_kind kind;
+	};
+
+	constexpr Keyword s_keywords[] = {
+		{"bool", Token_kind::keyword_bool},
+		{"break", Token_kind::keyword_break},
+		{"case", Token_kind::keyword_case},
+		{"const", Token_kind::keyword_const},
+		{"do", Token_kind::keyword_do},
+		{"double", Token_kind::keyword_double},
+		{"else", Token_kind::keyword_else},
+		{"enum", Token_kind::keyword_enum},
+		{"false", Token_kind::keyword_false},
+		{"goto", Token_kind::keyword_goto},
+		{"if", Token_kind::keyword_if},
+		{"int", Token_kind::keyword_int},
+		{"operator", Token_kind::keyword_operator},
+		{"requires", Token_kind::keyword_requires},
+		{"return", Token_kind::keyword_return},
+		{"struct", Token_kind::keyword_struct},
+		{"switch", Token_kind::keyword_switch},
+		{"template", Token_kind::keyword_template},
+		{"true", Token_kind::keyword_true},
+		{"typedef", Token_kind::keyword_typedef},
+		{"typename", Token_kind::keyword_typename},
+		{"void", Token_kind::keyword_void},
+		{"while", Token_kind::keyword_while},
+	};
+
+	constexpr std::size_t s_keyword_min_length = 2;
+	constexpr std::size_t s_keyword_max_length = 8;
+
+	/*
+	 * Perfect hash over the keywords: the first two characters and the length
+	 * pick a distinct slot for every keyword, so a lookup is one hash, one
+	 * table load and one comparison.
+	 */
+	constexpr auto keyword_hash(const char* first, std::size_t length) -> std::size_t
+	{
+		const auto c0 = static_cast<unsigned char>(first[0]);
+		const auto c1 = static_cast<unsigned char>(first[1]);
+		return (c0 + 6 * c1 + 5 * length) & 63;
+	}
+
+	struct Keyword_table
+	{
+		// Index into s_keywords plus one; zero for an empty slot.
+		std::array<std::uint8_t, 64> slots{};
+		bool perfect = true;
+	};
+
+	constexpr auto make_keyword_table() -> Keyword_table
+	{
+		Keyword_table table{};
+		for (std::size_t i = 0; i < std::size(s_keywords); ++i)
+		{
+			const std::string_view spelling = s_keywords[i].spelling;
+			const std::size_t slot = keyword_hash(spelling.data(), spelling.size());
+			if (table.slots[slot] != 0)
+			{
+				table.perfect = false;
+			}
+			table.slots[slot] = static_cast<std::uint8_t>(i + 1);
+		}
+		return table;
+	}
+
+	constexpr Keyword_table s_keyword_table = make_keyword_table();
+	static_assert(s_keyword_table.perfect, "keyword_hash must not map two keywords to one slot");
+}
+
+Token::Token(const char* begin, const char* end, Token_kind kind) :
+	begin(begin),
+	end(end),
+	kind(kind)
+{
 }
 
-auto is_digit(char c) -> bool
+auto is_trivia(Token_kind kind) -> bool
 {
-	switch (c)
+	switch (kind)
 	{
-	case '0':
-	case '1':
-	case '2':
-	case '3':
-	case '4':
-	case '5':
-	case '6':
-	case '7':
-	case '8':
-	case '9': {
+	case Token_kind::comment:
+	case Token_kind::newline:
+	case Token_kind::tab:
+	case Token_kind::space: {
 		return true;
 	} break;
 
@@ -90,11 +203,32 @@ auto is_digit(char c) -> bool
 	}
 }
 
-Token::Token(const char* begin, const char* end, Token_kind kind) :
-	begin(begin),
-	end(end),
-	kind(kind)
+auto is_keyword(Token_kind kind) -> bool
 {
+	return kind >= Token_kind::keyword_bool && kind <= Token_kind::keyword_while;
+}
+
+auto keyword_kind(const char* begin, const char* end) -> Token_kind
+{
+	const auto length = static_cast<std::size_t>(end - begin);
+	if (length < s_keyword_min_length || length > s_keyword_max_length)
+	{
+		return Token_kind::identifier;
+	}
+
+	const std::uint8_t slot = s_keyword_table.slots[keyword_hash(begin, length)];
+	if (slot == 0)
+	{
+		return Token_kind::identifier;
+	}
+
+	const Keyword& keyword = s_keywords[slot - 1];
+	if (keyword.spelling != std::string_view(begin, length))
+	{
+		return Token_kind::identifier;
+	}
+
+	return keyword.kind;
 }
 
 auto operator==(const Token& x, const Token& y) -> bool
@@ -136,256 +270,66 @@ auto Token_iterator::operator++() -> Token_iterator&
 	m_value.begin = m_value.end;
 	++m_value.end;
 
-	switch (*m_value.begin)
+	const auto c = static_cast<unsigned char>(*m_value.begin);
+	switch (s_lead.lead[c])
 	{
-	case 'a':
-	case 'b':
-	case 'c':
-	case 'd':
-	case 'e':
-	case 'f':
-	case 'g':
-	case 'h':
-	case 'i':
-	case 'j':
-	case 'k':
-	case 'l':
-	case 'm':
-	case 'n':
-	case 'o':
-	case 'p':
-	case 'q':
-	case 'r':
-	case 's':
-	case 't':
-	case 'u':
-	case 'v':
-	case 'w':
-	case 'x':
-	case 'y':
-	case 'z':
-	case 'A':
-	case 'B':
-	case 'C':
-	case 'D':
-	case 'E':
-	case 'F':
-	case 'G':
-	case 'H':
-	case 'I':
-	case 'J':
-	case 'K':
-	case 'L':
-	case 'M':
-	case 'N':
-	case 'O':
-	case 'P':
-	case 'Q':
-	case 'R':
-	case 'S':
-	case 'T':
-	case 'U':
-	case 'V':
-	case 'W':
-	case 'X':
-	case 'Y':
-	case 'Z':
-	case '_': {
-		m_value.end = std::find_if_not(m_value.end, m_end, [] (char c) -> bool {
-			return is_letter(c) || c == '_' || is_digit(c);
-		});
-		m_value.kind = Token_kind::identifier;
-	} break;
-
-	case '0':
-	case '1':
-	case '2':
-	case '3':
-	case '4':
-	case '5':
-	case '6':
-	case '7':
-	case '8':
-	case '9': {
-		m_value.end = std::find_if_not(m_value.end, m_end, is_digit);
-		if (m_value.end != m_end && *m_value.end == '.')
-		{
-			m_value.end = std::find_if_not(m_value.end + 1, m_end, is_digit);
-			m_value.kind = Token_kind::real;
-		}
-		else
-		{
-			m_value.kind = Token_kind::integer;
-		}
-	} break;
-
-	case '.': {
-		if (m_value.end != m_end && is_digit(*m_value.end))
-		{
-			m_value.end = std::find_if_not(m_value.end + 1, m_end, is_digit);
-			m_value.kind = Token_kind::real;
-		}
-		else
-		{
-			m_value.kind = Token_kind::dot;
-		}
-	} break;
-
-	case '/': {
-		if (m_value.end != m_end && *m_value.end == '/')
-		{
-			m_value.end = std::find(m_value.end + 1, m_end, '\n');
-			m_value.kind = Token_kind::comment;
-		}
-		else
-		{
-			m_value.kind = Token_kind::forward_slash;
-		}
-	} break;
-
-	case '(': {
-		m_value.kind = Token_kind::open_paren;
-	} break;
-
-	case ')': {
-		m_value.kind = Token_kind::close_paren;
-	} break;
-
-	case '[': {
-		m_value.kind = Token_kind::open_bracket;
-	} break;
-
-	case ']': {
-		m_value.kind = Token_kind::close_bracket;
-	} break;
-
-	case '{': {
-		m_value.kind = Token_kind::open_brace;
-	} break;
-
-	case '}': {
-		m_value.kind = Token_kind::close_brace;
-	} break;
-
-	case ',': {
-		m_value.kind = Token_kind::comma;
-	} break;
-
-	case ' ': {
-		m_value.kind = Token_kind::space;
-	} break;
-
-	case '\n': {
-		m_value.kind = Token_kind::newline;
-	} break;
-
-	case '\t': {
-		m_value.kind = Token_kind::tab;
-	} break;
-
-	case ';': {
-		m_value.kind = Token_kind::semicolon;
-	} break;
-
-	case '&': {
-		if (m_value.end != m_end && *m_value.end == '&')
-		{
-			++m_value.end;
-			m_value.kind = Token_kind::double_ampersand;
-		}
-		else
-		{
-			m_value.kind = Token_kind::ampersand;
-		}
+	case Lead::single: {
+		m_value.kind = s_lead.kind[c];
 	} break;
 
-	case '|': {
-		if (m_value.end != m_end && *m_value.end == '|')
+	case Lead::pair: {
+		if (m_value.end != m_end && *m_value.end == s_lead.pair_next[c])
 		{
 			++m_value.end;
-			m_value.kind = Token_kind::double_pipe;
+			m_value.kind = s_lead.pair_kind[c];
 		}
 		else
 		{
-			m_value.kind = Token_kind::pipe;
+			m_value.kind = s_lead.kind[c];
 		}
 	} break;
 
-	case '-': {
-		m_value.kind = Token_kind::minus;
-	} break;
-
-	case '!': {
-		if (m_value.end != m_end && *m_value.end == '=')
-		{
-			++m_value.end;
-			m_value.kind = Token_kind::bang_equals;
-		}
-		else
-		{
-			m_value.kind = Token_kind::bang;
-		}
-	} break;
-
-	case '*': {
-		m_value.kind = Token_kind::star;
-	} break;
-
-	case '%': {
-		m_value.kind = Token_kind::percent;
-	} break;
-
-	case '+': {
-		m_value.kind = Token_kind::plus;
+	case Lead::identifier: {
+		m_value.end = scan_identifier(m_value.end, m_end);
+		m_value.kind = keyword_kind(m_value.begin, m_value.end);
 	} break;
 
-	case '=': {
-		if (m_value.end != m_end && *m_value.end == '=')
+	case Lead::number: {
+		m_value.end = scan_digits(m_value.end, m_end);
+		if (m_value.end != m_end && *m_value.end == '.')
 		{
-			++m_value.end;
-			m_value.kind = Token_kind::double_equals;
+			m_value.end = scan_digits(m_value.end + 1, m_end);
+			m_value.kind = Token_kind::real;
 		}
 		else
 		{
-			m_value.kind = Token_kind::equals;
+			m_value.kind = Token_kind::integer;
 		}
 	} break;
 
-	case '<': {
-		if (m_value.end != m_end && *m_value.end == '=')
+	case Lead::dot: {
+		if (m_value.end != m_end && is_digit(*m_value.end))
 		{
-			++m_value.end;
-			m_value.kind = Token_kind::less_equals;
+			m_value.end = scan_digits(m_value.end + 1, m_end);
+			m_value.kind = Token_kind::real;
 		}
 		else
 		{
-			m_value.kind = Token_kind::less;
+			m_value.kind = Token_kind::dot;
 		}
 	} break;
 
-	case '>': {
-		if (m_value.end != m_end && *m_value.end == '=')
+	case Lead::slash: {
+		if (m_value.end != m_end && *m_value.end == '/')
 		{
-			++m_value.end;
-			m_value.kind = Token_kind::greater_equals;
+			m_value.end = scan_line(m_value.end + 1, m_end);
+			m_value.kind = Token_kind::comment;
 		}
 		else
 		{
-			m_value.kind = Token_kind::greater;
+			m_value.kind = Token_kind::forward_slash;
 		}
 	} break;
-
-	case ':': {
-		m_value.kind = Token_kind::colon;
-	} break;
-
-	case '~': {
-		m_value.kind = Token_kind::tilde;
-	} break;
-
-	default: {
-		m_value.kind = Token_kind::invalid;
-	} break;
 	}
 
 	return *this;
@@ -2,9 +2,10 @@
 #define EOP_LANG_TOKEN_ITERATOR_H
 
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
 
-enum class Token_kind
+enum class Token_kind : std::uint8_t
 {
 	invalid,
 	identifier,
@@ -42,6 +43,29 @@ enum class Token_kind
 	greater_equals,
 	colon,
 	tilde,
+	keyword_bool,
+	keyword_break,
+	keyword_case,
+	keyword_const,
+	keyword_do,
+	keyword_double,
+	keyword_else,
+	keyword_enum,
+	keyword_false,
+	keyword_goto,
+	keyword_if,
+	keyword_int,
+	keyword_operator,
+	keyword_requires,
+	keyword_return,
+	keyword_struct,
+	keyword_switch,
+	keyword_template,
+	keyword_true,
+	keyword_typedef,
+	keyword_typename,
+	keyword_void,
+	keyword_while,
 };
 
 struct Token
@@ -54,6 +78,13 @@ struct Token
 	Token(const char* begin, const char* end, Token_kind kind);
 };
 
+// Whitespace and comments.
+auto is_trivia(Token_kind kind) -> bool;
+auto is_keyword(Token_kind kind) -> bool;
+
+// The keyword kind of [begin, end), or Token_kind::identifier.
+auto keyword_kind(const char* begin, const char* end) -> Token_kind;
+
 auto operator==(const Token& x, const Token& y) -> bool;
 auto operator!=(const Token& x, const Token& y) -> bool;
 
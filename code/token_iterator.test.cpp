@@ -1,7 +1,11 @@
 #include "token_iterator.h"
+#include "scan.h"
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <cstring>
+#include <vector>
+
 TEST_CASE("Lex empty input",  "[token iterator]")
 {
 	const char input[] = "";
@@ -128,3 +132,69 @@ TEST_CASE("Lex comment", "[token iterator]")
 	++begin;
 	REQUIRE(begin == end);
 }
+
+TEST_CASE("Lex same tokens with every scanner", "[token iterator]")
+{
+	const char input[] =
+		"template <typename T>\n"
+		"requires(Regular(T))\n"
+		"T very_long_identifier_name_that_spans_more_than_one_vector_register(const T& x) // comment that is long enough to need several blocks\n"
+		"{\n"
+		"\treturn x * 1234567890123456789012345678901234567890 + 3.14159265358979323846264338327950288 - .5;\n"
+		"\tx && y || z != 0 <= 1 >= 2 == 3 / 4 % 5 ! ? ~\n"
+		"}\n"
+		"//";
+	const char* input_end = input + sizeof(input) - 1;
+
+	const Scan_isa previous = scan_select(Scan_isa::scalar);
+	std::vector<Token> expected(Token_iterator(input, input_end), Token_iterator(input_end, input_end));
+
+	for (Scan_isa isa : {Scan_isa::sse2, Scan_isa::avx2})
+	{
+		if (!scan_supported(isa))
+		{
+			continue;
+		}
+
+		scan_select(isa);
+		Token_iterator iter(input, input_end);
+		Token_iterator end(input_end, input_end);
+		for (const Token& token : expected)
+		{
+			REQUIRE(iter != end);
+			REQUIRE(iter->begin == token.begin);
+			REQUIRE(iter->end == token.end);
+			REQUIRE(iter->kind == token.kind);
+			++iter;
+		}
+		REQUIRE(iter == end);
+	}
+
+	scan_select(previous);
+}
+
+TEST_CASE("Lex keywords", "[token iterator]")
+{
+	const char* const keywords[] = {
+		"bool", "break", "case", "const", "do", "double", "else", "enum",
+		"false", "goto", "if", "int", "operator", "requires", "return", "struct",
+		"switch", "template", "true", "typedef", "typename", "void", "while",
+	};
+
+	for (const char* keyword : keywords)
+	{
+		const char* keyword_end = keyword + std::strlen(keyword);
+		Token_iterator iter(keyword, keyword_end);
+		REQUIRE(is_keyword(iter->kind));
+		REQUIRE(iter->end == keyword_end);
+	}
+
+	const char* const identifiers[] = {"d", "iff", "Int", "whilex", "typenames", "doubl", "_if", "struct_"};
+	for (const char* identifier : identifiers)
+	{
+		const char* identifier_end = identifier + std::strlen(identifier);
+		Token_iterator iter(identifier, identifier_end);
+		REQUIRE(iter->kind == Token_kind::identifier);
+		REQUIRE(iter->end == identifier_end);
+	}
+}